@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// the SPIR-V of shaders/*.vert and *.frag, compiled at build time when EMBED_SHADERS is on,
+// by the file name the GLSL is loaded from, nullptr for a shader that was not embedded
+const std::vector<unsigned int>* find_embedded_shader(const std::string& file);
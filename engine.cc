@@ -30,6 +30,10 @@ Engine::Engine(int width, int height, uint32_t renderPassCount) : width(width),
         },
         renderPassCount + 1);
 
+    globals = vulkan.createUniformBuffer(sizeof(Globals));
+    globals.stage = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+    vulkan.setGlobalUniform(globals);
+
     glfwSetWindowUserPointer(window, this);
     glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
         // (1) ALWAYS forward mouse data to ImGui! This is automatic with default backends. With your own backend:
@@ -105,13 +109,17 @@ Engine::~Engine() {
     ImGui::DestroyContext();
 
     vulkan.device.destroyDescriptorPool(imgui_pool);
+    vulkan.destroyUniformBuffer(globals);
 
     glfwDestroyWindow(window);
     glfwTerminate();
 }
 
 void Engine::run() {
+    auto init_start = std::chrono::steady_clock::now();
+    scene->vulkan = &vulkan;
     scene->init();
+    startup_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - init_start).count();
 
     // Setup Platform/Renderer backends
     ImGui_ImplVulkan_InitInfo init_info = {};
@@ -143,6 +151,7 @@ void Engine::render() {
     dt = t - prev_t;
 
     player->update();
+    write_globals();
     scene->update();
 
     // clear mouse_dx, mouse_dy for next cycle
@@ -164,7 +173,7 @@ void Engine::render() {
             const bool is_minimized = (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f);
             if (!is_minimized) {
                 vulkan.nextPass();
-                ImGui_ImplVulkan_RenderDrawData(draw_data, vulkan.frame.commandBuffer());
+                ImGui_ImplVulkan_RenderDrawData(draw_data, vulkan.commandBuffer());
             }
         }
 
@@ -193,6 +202,13 @@ void Engine::render() {
     };
 }
 
+void Engine::write_globals() {
+    Globals data = {player->proj, player->view, player->position, get_time(),
+                    glm::vec2(vulkan.imageExtent.width, vulkan.imageExtent.height)};
+    data.proj[1][1] *= -1;
+    vulkan.writeUniform(globals, &data);
+}
+
 void Engine::set_window_pos(int xpos, int ypos) {
     this->xpos = xpos;
     this->ypos = ypos;
@@ -210,6 +226,14 @@ void Engine::EngineGui::gui_draw() {
                 vk::apiVersionVariant(prop.apiVersion));
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
                 ImGui::GetIO().Framerate);
+    ImGui::Text("Scene init %.1f ms, %u pipelines for %zu draws in %.1f ms, %s pipeline cache", engine.startup_time,
+                engine.vulkan.pipelineCount, engine.vulkan.drawResources.size(), engine.vulkan.pipelineTime,
+                engine.vulkan.pipelineCacheLoaded ? "warm" : "cold");
+    ImGui::Text("%u shaders in %.1f ms, %u from the shader cache", engine.vulkan.shaderCount,
+                engine.vulkan.shaderTime, engine.vulkan.shaderCacheHits);
+    ImGui::Text("%u textures in %.1f ms, %u baked, %.1f MB on the GPU instead of %.1f MB as RGBA8",
+                engine.vulkan.textureCount, engine.vulkan.textureTime, engine.vulkan.bakedTextureCount,
+                engine.vulkan.textureBytes / 1048576.0f, engine.vulkan.textureRgbaBytes / 1048576.0f);
     // ImGui::Text("Chunk x: %d, y: %d, z: %d", (int)engine.player->position.x / CHUNK_SIZE,
     //             (int)engine.player->position.y / CHUNK_SIZE, (int)engine.player->position.z / CHUNK_SIZE);
     ImGui::Text("Player direction %d", (360 - (int)glm::degrees(engine.player->yaw) % 360) % 360);
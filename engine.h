@@ -52,6 +52,15 @@ class Engine {
         return static_cast<P&>(*player);
     }
 
+    // mirrors globals_t of shaders/globals.glsl, written once per frame and bound for every draw
+    struct Globals {
+        glm::mat4 proj;  // flipped for the clip space of vulkan
+        glm::mat4 view;
+        glm::vec3 camera_pos;
+        float time;
+        glm::vec2 resolution;
+    };
+
     Vulkan vulkan;
     float mouse_dx = 0, mouse_dy = 0;
 
@@ -63,6 +72,7 @@ class Engine {
 
    private:
     void render();
+    void write_globals();
     void handle_events(int button, int action) { player->handle_events(button, action); }
 
    private:
@@ -78,6 +88,7 @@ class Engine {
     std::chrono::system_clock::time_point start_time;
     std::chrono::system_clock::time_point t;
     std::chrono::duration<float> dt;
+    float startup_time = 0;  // in milliseconds, the scene init with its shaders and pipelines
 
     float mouse_x = std::numeric_limits<float>().infinity();
     float mouse_y = std::numeric_limits<float>().infinity();
@@ -87,6 +98,8 @@ class Engine {
     bool imgui_show = false;
     vk::DescriptorPool imgui_pool;
 
+    Vulkan::Buffer globals;
+
     std::unique_ptr<Scene> scene;
     std::unique_ptr<Player> player;
     std::vector<std::unique_ptr<Gui>> guis;
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <set>
+
+#include "cloud_grid.h"
+#include "far_grid.h"
+#include "fluid_sim.h"
+#include "world_gen.h"
+
+namespace {
+float elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <int Size>
+void bench() {
+    using C = Chunk<Size>;
+
+    auto voxels = std::make_unique<typename C::WorldVoxels>();
+    BasicWorldGen<Size> gen(*voxels);
+
+    auto start = std::chrono::steady_clock::now();
+    gen.generate();
+    float gen_time = elapsed_ms(start);
+
+    std::vector<typename C::Mesh> meshes(C::WORLD_VOL);
+    start = std::chrono::steady_clock::now();
+#pragma omp parallel for
+    for (int i = 0; i < C::WORLD_VOL; ++i)
+        meshes[i] = C::build_mesh(*voxels, i % C::WORLD_W, i / C::WORLD_AREA, i / C::WORLD_W % C::WORLD_D);
+    float mesh_time = elapsed_ms(start);
+
+    // every non-empty chunk is one draw, or every non-empty region when it is fully visible
+    size_t draw_calls = 0, vertex_bytes = 0;
+    std::vector<bool> region_used(C::WORLD_AREA);
+    for (int i = 0; i < C::WORLD_VOL; ++i) {
+        auto& mesh = meshes[i];
+        if (mesh.opaque.empty() && mesh.translucent.empty()) continue;
+        ++draw_calls;
+        vertex_bytes += (mesh.opaque.size() + mesh.translucent.size()) * sizeof(typename C::Vertex);
+        region_used[i % C::WORLD_W / REGION_SIZE + C::WORLD_W * (i / C::WORLD_W % C::WORLD_D / REGION_SIZE)] = true;
+    }
+    size_t region_draws = std::count(region_used.begin(), region_used.end(), true);
+    size_t voxel_bytes = C::WORLD_VOL * sizeof(typename C::Voxels);
+
+    constexpr float MB = 1024 * 1024;
+    printf("%4d %8d %10.1f %10.1f %8zu %8zu %10.1f %10.1f\n", Size, C::WORLD_VOL, gen_time, mesh_time, draw_calls,
+           region_draws, voxel_bytes / MB, vertex_bytes / MB);
+}
+
+// the std::set based merger the bit grid one replaced, kept as the reference output
+std::vector<CloudGrid::Quad> merge_quads_reference(const CloudGrid& grid) {
+    std::vector<CloudGrid::Quad> quads;
+    std::set<int> visited;
+    auto left = [&](int x, int z) { return grid.test(x, z) && visited.find(x + grid.width * z) == visited.end(); };
+
+    for (int z = 0; z < grid.depth; ++z)
+        for (int x = 0; x < grid.width; ++x) {
+            if (!left(x, z)) continue;
+
+            int w = 1;
+            while (x + w < grid.width && left(x + w, z)) ++w;
+
+            int d = std::numeric_limits<int>::max();
+            for (int ix = 0; ix < w; ++ix) {
+                int column = 1;
+                while (z + column < grid.depth && left(x + ix, z + column)) ++column;
+                d = std::min(d, column);
+            }
+
+            for (int ix = 0; ix < w; ++ix)
+                for (int iz = 0; iz < d; ++iz) visited.insert(x + ix + grid.width * (z + iz));
+            quads.push_back({x, z, w, d});
+        }
+
+    return quads;
+}
+
+// every set cell covered exactly once
+bool covers(const CloudGrid& grid, const std::vector<CloudGrid::Quad>& quads) {
+    CloudGrid covered(grid.width, grid.depth);
+    for (auto& quad : quads)
+        for (int z = quad.z; z < quad.z + quad.d; ++z)
+            for (int x = quad.x; x < quad.x + quad.w; ++x) {
+                if (covered.test(x, z)) return false;
+                covered.set(x, z);
+            }
+    return covered.bits == grid.bits;
+}
+
+void bench_clouds(int size) {
+    CloudGrid grid(size, size);
+    grid.gen_clouds();
+
+    // the reference gets too slow past that
+    float reference_time = 0;
+    std::vector<CloudGrid::Quad> reference;
+    if (size <= 2048) {
+        auto start = std::chrono::steady_clock::now();
+        reference = merge_quads_reference(grid);
+        reference_time = elapsed_ms(start);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto quads = grid.merge_quads();
+    float bitmap_time = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    auto strip_quads = grid.merge_quads(CLOUD_STRIPS);
+    float strips_time = elapsed_ms(start);
+
+    printf("%5d %10.1f %10.1f %10.1f %8zu %8zu %6s %6s\n", size, reference_time, bitmap_time, strips_time,
+           quads.size(), strip_quads.size(), size > 2048 ? "-" : reference == quads ? "yes" : "NO",
+           covers(grid, strip_quads) ? "yes" : "NO");
+}
+
+// the CPU side of both cloud modes, the procedural one moves all the work to clouds_slab.frag
+void bench_cloud_modes() {
+    constexpr int size = WORLD_W * CHUNK_SIZE;
+    constexpr float KB = 1024;
+
+    auto start = std::chrono::steady_clock::now();
+    CloudGrid grid(size, size);
+    grid.gen_clouds();
+    auto quads = grid.merge_quads(CLOUD_PARALLEL_MERGE ? CLOUD_STRIPS : 1);
+    float mesh_time = elapsed_ms(start);
+
+    printf("%10s %10s %10s %10s\n", "mode", "build(ms)", "vertices", "memory(KB)");
+    printf("%10s %10.1f %10zu %10.1f\n", "mesh", mesh_time, quads.size() * 6,
+           (quads.size() * 6 * sizeof(glm::vec3) + grid.bits.size() * sizeof(uint64_t)) / KB);
+    printf("%10s %10.1f %10d %10.1f\n", "slab", 0.0f, 36, 36 * sizeof(glm::vec3) / KB);
+}
+
+// one voxel at a time through the dense arrays, the reference for the DAG traversal
+VoxelDag::Hit raycast_dense(const Chunk<CHUNK_SIZE>::WorldVoxels& voxels, glm::vec3 origin, glm::vec3 dir,
+                            float max_t) {
+    using C = Chunk<CHUNK_SIZE>;
+    glm::ivec3 pos(std::floor(origin.x), std::floor(origin.y), std::floor(origin.z)), normal(0), step;
+    glm::vec3 next, delta;
+    for (int axis = 0; axis < 3; ++axis) {
+        step[axis] = dir[axis] > 0 ? 1 : -1;
+        delta[axis] = dir[axis] != 0 ? std::abs(1 / dir[axis]) : std::numeric_limits<float>::infinity();
+        float border = dir[axis] > 0 ? pos[axis] + 1 - origin[axis] : origin[axis] - pos[axis];
+        next[axis] = border * delta[axis];
+    }
+
+    for (float t = 0; t < max_t;) {
+        int chunk_index = C::chunk_index(pos.x, pos.y, pos.z);
+        if (chunk_index != -1) {
+            uint8_t voxel_id = (*voxels[chunk_index])[C::voxel_index(pos.x, pos.y, pos.z)];
+            if (voxel_id) return {voxel_id, pos, normal, t};
+        }
+
+        int axis = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+        t = next[axis];
+        next[axis] += delta[axis];
+        pos[axis] += step[axis];
+        normal = glm::ivec3(0);
+        normal[axis] = -step[axis];
+    }
+    return {0, glm::ivec3(0), glm::ivec3(0), max_t};
+}
+
+void bench_far_field() {
+    using C = Chunk<CHUNK_SIZE>;
+    constexpr float MB = 1024 * 1024;
+
+    auto voxels = std::make_unique<C::WorldVoxels>();
+    WorldGen(*voxels).generate();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<VoxelDag> dags;
+    for (int cz = 0; cz < C::WORLD_D; cz += REGION_SIZE)
+        for (int cx = 0; cx < C::WORLD_W; cx += REGION_SIZE) dags.push_back(C::build_dag(*voxels, cx, cz, REGION_SIZE));
+    float build_time = elapsed_ms(start);
+
+    size_t dag_bytes = 0;
+    for (auto& dag : dags) dag_bytes += dag.memory_bytes();
+
+    // rays from above the terrain looking down at a slant, inside the center region (the corners are ocean)
+    constexpr int regions_w = (C::WORLD_W + REGION_SIZE - 1) / REGION_SIZE, center = regions_w / 2;
+    auto& dag = dags[center + regions_w * center];
+    glm::vec3 offset(center * REGION_SIZE * CHUNK_SIZE, 0, center * REGION_SIZE * CHUNK_SIZE);
+
+    std::default_random_engine e(SEED);
+    std::uniform_real_distribution<float> pos_dist(0, REGION_SIZE * CHUNK_SIZE), dir_dist(-1, 1);
+    std::vector<std::pair<glm::vec3, glm::vec3>> rays(100000);
+    for (auto& ray : rays) {
+        ray.first = glm::vec3(pos_dist(e), WORLD_H * CHUNK_SIZE - 0.5f, pos_dist(e));
+        ray.second = glm::normalize(glm::vec3(dir_dist(e), -1, dir_dist(e)));
+    }
+
+    std::vector<VoxelDag::Hit> dag_hits(rays.size()), dense_hits(rays.size());
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rays.size(); ++i) dag_hits[i] = dag.raycast(rays[i].first, rays[i].second, 1000);
+    float dag_time = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rays.size(); ++i)
+        dense_hits[i] = raycast_dense(*voxels, rays[i].first + offset, rays[i].second, 1000);
+    float dense_time = elapsed_ms(start);
+
+    // rays leaving the region may hit its neighbors in the dense arrays
+    size_t same = 0, inside = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        auto hit = dense_hits[i];
+        hit.pos -= glm::ivec3(offset);
+        if (hit.voxel_id && (hit.pos.x >= REGION_SIZE * CHUNK_SIZE || hit.pos.z >= REGION_SIZE * CHUNK_SIZE ||
+                             hit.pos.x < 0 || hit.pos.z < 0))
+            continue;
+        ++inside;
+        if (dag_hits[i].voxel_id == hit.voxel_id && (!hit.voxel_id || dag_hits[i].pos == hit.pos)) ++same;
+    }
+
+    // a single edit, then the path copy is dropped by compact()
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) dag.set(glm::ivec3(i % 64, 10, i / 64), i % 2 ? STONE : 0);
+    float edit_time = elapsed_ms(start) / 1000;
+
+    printf("%zu regions, dense %.1f MB, DAG %.1f MB, built in %.1f ms, %.2f us per edit\n", dags.size(),
+           C::WORLD_VOL * sizeof(C::Voxels) / MB, dag_bytes / MB, build_time, edit_time * 1000);
+    printf("%zu rays: DAG %.1f ms, dense %.1f ms, %zu / %zu same hits\n", rays.size(), dag_time, dense_time, same,
+           inside);
+
+    // the grid far_field.frag marches, every cell in an empty brick is skipped with it
+    FarGrid grid(C::WORLD_W * CHUNK_SIZE / FAR_CELL_SIZE, C::WORLD_H * CHUNK_SIZE / FAR_CELL_SIZE,
+                 C::WORLD_D * CHUNK_SIZE / FAR_CELL_SIZE, FAR_CELL_SIZE);
+    start = std::chrono::steady_clock::now();
+    grid.build(
+        [&](int wx, int wy, int wz) { return (*(*voxels)[C::chunk_index(wx, wy, wz)])[C::voxel_index(wx, wy, wz)]; });
+    float grid_time = elapsed_ms(start);
+
+    std::array<size_t, FarGrid::LEVELS + 1> skipped{};
+    for (int y = 0; y < grid.height; ++y)
+        for (int z = 0; z < grid.depth; ++z)
+            for (int x = 0; x < grid.width; ++x) {
+                glm::ivec3 cell(x, y, z);
+                int level = FarGrid::LEVELS;
+                while (level > 0 && !grid.is_empty_brick(cell, level)) --level;
+                if (level || !grid.voxel_id(cell)) ++skipped[level];
+            }
+    size_t cells = grid.texels.size();
+    printf("far grid %d x %d x %d cells, %.1f MB, built in %.1f ms, empty in bricks of 16/4/1: %.0f%% %.0f%% %.0f%%\n",
+           grid.width, grid.height, grid.depth, grid.memory_bytes() / MB, grid_time, 100.0f * skipped[2] / cells,
+           100.0f * skipped[1] / cells, 100.0f * skipped[0] / cells);
+}
+
+// a spring on the highest column, ticked on this thread until the flow settles
+void bench_fluid() {
+    using C = Chunk<CHUNK_SIZE>;
+    constexpr int width = C::WORLD_W * CHUNK_SIZE, height = C::WORLD_H * CHUNK_SIZE, depth = C::WORLD_D * CHUNK_SIZE;
+
+    auto voxels = std::make_unique<C::WorldVoxels>();
+    WorldGen(*voxels).generate();
+    auto get_voxel = [&](int wx, int wy, int wz) {
+        return (*(*voxels)[C::chunk_index(wx, wy, wz)])[C::voxel_index(wx, wy, wz)];
+    };
+
+    FluidSim fluid(width, height, depth);
+    auto start = std::chrono::steady_clock::now();
+    fluid.init(get_voxel);
+    float init_time = elapsed_ms(start);
+
+    glm::ivec3 spring(0);
+    for (int z = 0; z < depth; z += 8)
+        for (int x = 0; x < width; x += 8) {
+            if (get_voxel(x, height - 1, z)) continue;
+            int y = height - 1;
+            while (y > 0 && !get_voxel(x, y - 1, z)) --y;
+            if (y > spring.y) spring = glm::ivec3(x, y, z);
+        }
+    fluid.set_voxel(spring, WATER);
+
+    int ticks = 0;
+    float total_time = 0, max_time = 0;
+    size_t max_active = 0;
+    do {
+        fluid.step();
+        ++ticks;
+        total_time += fluid.tick_time;
+        max_time = std::max(max_time, fluid.tick_time.load());
+        max_active = std::max(max_active, fluid.active_cells.load());
+    } while (fluid.active_cells && ticks < 1000);
+
+    printf("%d x %d x %d world, solid bits built in %.1f ms\n", width, height, depth, init_time);
+    printf("spring at %d %d %d settled in %d ticks, %zu water cells, up to %zu active, %.3f ms per tick, %.3f max\n",
+           spring.x, spring.y, spring.z, ticks, fluid.water_cells.load(), max_active, total_time / ticks, max_time);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    printf("seed %d, world %d x %d x %d blocks\n", SEED, WORLD_W * CHUNK_SIZE, WORLD_H * CHUNK_SIZE,
+           WORLD_D * CHUNK_SIZE);
+    printf("%4s %8s %10s %10s %8s %8s %10s %10s\n", "size", "chunks", "gen(ms)", "mesh(ms)", "draws", "regions",
+           "voxel(MB)", "vertex(MB)");
+
+    bench<16>();
+    bench<32>();
+    bench<48>();
+    bench<64>();
+
+    printf("\nclouds, the single merge against %d parallel strips\n", CLOUD_STRIPS);
+    printf("%5s %10s %10s %10s %8s %8s %6s %6s\n", "size", "set(ms)", "bits(ms)", "strips(ms)", "quads",
+           "strip q.", "same", "cover");
+    for (int size : {960, 2048, 4096}) bench_clouds(size);
+
+    printf("\nclouds, mesh and procedural modes\n");
+    bench_cloud_modes();
+
+    printf("\nfar field, %d x %d columns per region\n", REGION_SIZE, REGION_SIZE);
+    bench_far_field();
+
+    printf("\nfluid, %zu cells per tick\n", FLUID_TICK_BUDGET);
+    bench_fluid();
+
+    return 0;
+}
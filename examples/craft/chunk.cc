@@ -0,0 +1,208 @@
+#include "chunk.h"
+
+namespace {
+// water does not hide what is behind it, only the faces between two water cells
+template <int Size>
+bool is_void(int x, int y, int z, int wx, int wy, int wz, const typename Chunk<Size>::WorldVoxels& world_voxels,
+             uint8_t voxel_id = 0) {
+    int chunk_index = Chunk<Size>::chunk_index(wx, wy, wz);
+    if (chunk_index == -1) return true;
+
+    auto& chunk_voxels = world_voxels[chunk_index];
+    int voxel_index = Chunk<Size>::index((x + Size) % Size, (y + Size) % Size, (z + Size) % Size);
+    uint8_t neighbor = chunk_voxels->at(voxel_index);
+    if (!neighbor) return true;
+
+    return Chunk<Size>::is_water(neighbor) && !Chunk<Size>::is_water(voxel_id);
+}
+
+template <int Size>
+std::array<uint8_t, 4> get_ao(int x, int y, int z, int wx, int wy, int wz,
+                              const typename Chunk<Size>::WorldVoxels& world_voxels, char plane) {
+    uint8_t a, b, c, d, e, f, g, h;
+    if (plane == 'Y') {
+        a = is_void<Size>(x, y, z - 1, wx, wy, wz - 1, world_voxels);
+        b = is_void<Size>(x - 1, y, z - 1, wx - 1, wy, wz - 1, world_voxels);
+        c = is_void<Size>(x - 1, y, z, wx - 1, wy, wz, world_voxels);
+        d = is_void<Size>(x - 1, y, z + 1, wx - 1, wy, wz + 1, world_voxels);
+        e = is_void<Size>(x, y, z + 1, wx, wy, wz + 1, world_voxels);
+        f = is_void<Size>(x + 1, y, z + 1, wx + 1, wy, wz + 1, world_voxels);
+        g = is_void<Size>(x + 1, y, z, wx + 1, wy, wz, world_voxels);
+        h = is_void<Size>(x + 1, y, z - 1, wx + 1, wy, wz - 1, world_voxels);
+    } else if (plane == 'X') {
+        a = is_void<Size>(x, y, z - 1, wx, wy, wz - 1, world_voxels);
+        b = is_void<Size>(x, y - 1, z - 1, wx, wy - 1, wz - 1, world_voxels);
+        c = is_void<Size>(x, y - 1, z, wx, wy - 1, wz, world_voxels);
+        d = is_void<Size>(x, y - 1, z + 1, wx, wy - 1, wz + 1, world_voxels);
+        e = is_void<Size>(x, y, z + 1, wx, wy, wz + 1, world_voxels);
+        f = is_void<Size>(x, y + 1, z + 1, wx, wy + 1, wz + 1, world_voxels);
+        g = is_void<Size>(x, y + 1, z, wx, wy + 1, wz, world_voxels);
+        h = is_void<Size>(x, y + 1, z - 1, wx, wy + 1, wz - 1, world_voxels);
+    } else {  // Z plane
+        a = is_void<Size>(x - 1, y, z, wx - 1, wy, wz, world_voxels);
+        b = is_void<Size>(x - 1, y - 1, z, wx - 1, wy - 1, wz, world_voxels);
+        c = is_void<Size>(x, y - 1, z, wx, wy - 1, wz, world_voxels);
+        d = is_void<Size>(x + 1, y - 1, z, wx + 1, wy - 1, wz, world_voxels);
+        e = is_void<Size>(x + 1, y, z, wx + 1, wy, wz, world_voxels);
+        f = is_void<Size>(x + 1, y + 1, z, wx + 1, wy + 1, wz, world_voxels);
+        g = is_void<Size>(x, y + 1, z, wx, wy + 1, wz, world_voxels);
+        h = is_void<Size>(x - 1, y + 1, z, wx - 1, wy + 1, wz, world_voxels);
+    }
+
+    return {static_cast<uint8_t>(a + b + c), static_cast<uint8_t>(g + h + a), static_cast<uint8_t>(e + f + g),
+            static_cast<uint8_t>(c + d + e)};
+}
+
+template <typename Vertex>
+inline void add_data(std::vector<Vertex>& vertex_data, std::initializer_list<Vertex> vertices) {
+    for (auto& vertex : vertices) vertex_data.push_back(vertex);
+}
+}  // namespace
+
+template <int Size>
+typename Chunk<Size>::Mesh Chunk<Size>::build_mesh(const WorldVoxels& world_voxels, int cx, int cy, int cz) {
+    auto& voxels = world_voxels[cx + WORLD_W * cz + WORLD_AREA * cy];
+    Mesh result;
+
+    // ARRAY_SIZE = VOL * NUM_VOXEL_VERTICES * VERTEX_ATTRS
+    // NUM_VOXEL_VERTICES = 3(face) * 2(triagles) * 3(vertices)
+    // VERTEX_ATTRS: x, y, z, voxel_id, face_id
+    result.opaque.reserve(VOL * 18);
+
+    for (int x = 0; x < Size; ++x)
+        for (int y = 0; y < Size; ++y)
+            for (int z = 0; z < Size; ++z) {
+                auto voxel_id = (*voxels)[index(x, y, z)];
+                if (!voxel_id) continue;
+
+                auto& mesh = is_translucent(voxel_id) ? result.translucent : result.opaque;
+
+                // voxel world position
+                int wx = x + cx * Size;
+                int wy = y + cy * Size;
+                int wz = z + cz * Size;
+
+                Vertex v0, v1, v2, v3;
+
+                // top face
+                if (is_void<Size>(x, y + 1, z, wx, wy + 1, wz, world_voxels, voxel_id)) {
+                    // get AO(ambient occlusion) values
+                    auto ao = get_ao<Size>(x, y + 1, z, wx, wy + 1, wz, world_voxels, 'Y');
+                    bool flip_id = ao[1] + ao[3] > ao[0] + ao[2];
+
+                    v0 = pack(x, y + 1, z, voxel_id, 0, ao[0], flip_id);
+                    v1 = pack(x + 1, y + 1, z, voxel_id, 0, ao[1], flip_id);
+                    v2 = pack(x + 1, y + 1, z + 1, voxel_id, 0, ao[2], flip_id);
+                    v3 = pack(x, y + 1, z + 1, voxel_id, 0, ao[3], flip_id);
+
+                    if (flip_id)
+                        add_data(mesh, {v1, v0, v3, v1, v3, v2});
+                    else
+                        add_data(mesh, {v0, v3, v2, v0, v2, v1});
+                }
+
+                // bottom face
+                if (is_void<Size>(x, y - 1, z, wx, wy - 1, wz, world_voxels, voxel_id)) {
+                    auto ao = get_ao<Size>(x, y - 1, z, wx, wy - 1, wz, world_voxels, 'Y');
+                    bool flip_id = ao[1] + ao[3] > ao[0] + ao[2];
+
+                    v0 = pack(x, y, z, voxel_id, 1, ao[0], flip_id);
+                    v1 = pack(x + 1, y, z, voxel_id, 1, ao[1], flip_id);
+                    v2 = pack(x + 1, y, z + 1, voxel_id, 1, ao[2], flip_id);
+                    v3 = pack(x, y, z + 1, voxel_id, 1, ao[3], flip_id);
+
+                    if (flip_id)
+                        add_data(mesh, {v1, v3, v0, v1, v2, v3});
+                    else
+                        add_data(mesh, {v0, v2, v3, v0, v1, v2});
+                }
+
+                // right face
+                if (is_void<Size>(x + 1, y, z, wx + 1, wy, wz, world_voxels, voxel_id)) {
+                    auto ao = get_ao<Size>(x + 1, y, z, wx + 1, wy, wz, world_voxels, 'X');
+                    bool flip_id = ao[1] + ao[3] > ao[0] + ao[2];
+
+                    v0 = pack(x + 1, y, z, voxel_id, 2, ao[0], flip_id);
+                    v1 = pack(x + 1, y + 1, z, voxel_id, 2, ao[1], flip_id);
+                    v2 = pack(x + 1, y + 1, z + 1, voxel_id, 2, ao[2], flip_id);
+                    v3 = pack(x + 1, y, z + 1, voxel_id, 2, ao[3], flip_id);
+
+                    if (flip_id)
+                        add_data(mesh, {v3, v0, v1, v3, v1, v2});
+                    else
+                        add_data(mesh, {v0, v1, v2, v0, v2, v3});
+                }
+                // left face
+                if (is_void<Size>(x - 1, y, z, wx - 1, wy, wz, world_voxels, voxel_id)) {
+                    auto ao = get_ao<Size>(x - 1, y, z, wx - 1, wy, wz, world_voxels, 'X');
+                    bool flip_id = ao[1] + ao[3] > ao[0] + ao[2];
+
+                    v0 = pack(x, y, z, voxel_id, 3, ao[0], flip_id);
+                    v1 = pack(x, y + 1, z, voxel_id, 3, ao[1], flip_id);
+                    v2 = pack(x, y + 1, z + 1, voxel_id, 3, ao[2], flip_id);
+                    v3 = pack(x, y, z + 1, voxel_id, 3, ao[3], flip_id);
+
+                    if (flip_id)
+                        add_data(mesh, {v3, v1, v0, v3, v2, v1});
+                    else
+                        add_data(mesh, {v0, v2, v1, v0, v3, v2});
+                }
+                // back face
+                if (is_void<Size>(x, y, z - 1, wx, wy, wz - 1, world_voxels, voxel_id)) {
+                    auto ao = get_ao<Size>(x, y, z - 1, wx, wy, wz - 1, world_voxels, 'Z');
+                    bool flip_id = ao[1] + ao[3] > ao[0] + ao[2];
+
+                    v0 = pack(x, y, z, voxel_id, 4, ao[0], flip_id);
+                    v1 = pack(x, y + 1, z, voxel_id, 4, ao[1], flip_id);
+                    v2 = pack(x + 1, y + 1, z, voxel_id, 4, ao[2], flip_id);
+                    v3 = pack(x + 1, y, z, voxel_id, 4, ao[3], flip_id);
+
+                    if (flip_id)
+                        add_data(mesh, {v3, v0, v1, v3, v1, v2});
+                    else
+                        add_data(mesh, {v0, v1, v2, v0, v2, v3});
+                }
+                // front face
+                if (is_void<Size>(x, y, z + 1, wx, wy, wz + 1, world_voxels, voxel_id)) {
+                    auto ao = get_ao<Size>(x, y, z + 1, wx, wy, wz + 1, world_voxels, 'Z');
+                    bool flip_id = ao[1] + ao[3] > ao[0] + ao[2];
+
+                    v0 = pack(x, y, z + 1, voxel_id, 5, ao[0], flip_id);
+                    v1 = pack(x, y + 1, z + 1, voxel_id, 5, ao[1], flip_id);
+                    v2 = pack(x + 1, y + 1, z + 1, voxel_id, 5, ao[2], flip_id);
+                    v3 = pack(x + 1, y, z + 1, voxel_id, 5, ao[3], flip_id);
+
+                    if (flip_id)
+                        add_data(mesh, {v3, v1, v0, v3, v2, v1});
+                    else
+                        add_data(mesh, {v0, v2, v1, v0, v3, v2});
+                }
+            }
+
+    result.opaque.shrink_to_fit();
+    return result;
+}
+
+template <int Size>
+VoxelDag Chunk<Size>::build_dag(const WorldVoxels& world_voxels, int cx, int cz, int columns) {
+    int ox = cx * Size, oz = cz * Size;
+    int width = std::min(columns, WORLD_W - cx) * Size, depth = std::min(columns, WORLD_D - cz) * Size;
+    int height = WORLD_H * Size;
+
+    auto get_voxel = [&](int x, int y, int z) -> uint8_t {
+        if (x >= width || y >= height || z >= depth) return 0;
+
+        int wx = ox + x, wz = oz + z;
+        return (*world_voxels[chunk_index(wx, y, wz)])[voxel_index(wx, y, wz)];
+    };
+    auto is_empty = [&](int x, int y, int z, int size) { return x >= width || y >= height || z >= depth; };
+
+    VoxelDag dag(dag_levels(columns));
+    dag.build(get_voxel, is_empty);
+    return dag;
+}
+
+template struct Chunk<16>;
+template struct Chunk<32>;
+template struct Chunk<48>;
+template struct Chunk<64>;
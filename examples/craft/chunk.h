@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "settings.h"
+#include "voxel_dag.h"
+
+// Chunk storage, meshing and the packed vertex layout for a given chunk size.
+// The chunks cover (at least) the blocks of the default settings whatever the size is, and the
+// terrain is clipped to those blocks, so the sizes instantiated in chunk.cc compare the same world.
+template <int Size>
+struct Chunk {
+    static constexpr int SIZE = Size;
+    static constexpr int H_SIZE = Size / 2;
+    static constexpr int AREA = Size * Size;
+    static constexpr int VOL = AREA * Size;
+    static constexpr float SPHERE_RADIUS = H_SIZE * 1.732050807569f;
+
+    static constexpr int WORLD_W = (::WORLD_W * CHUNK_SIZE + Size - 1) / Size;
+    static constexpr int WORLD_H = (::WORLD_H * CHUNK_SIZE + Size - 1) / Size;
+    static constexpr int WORLD_D = (::WORLD_D * CHUNK_SIZE + Size - 1) / Size;
+    static constexpr int WORLD_AREA = WORLD_W * WORLD_D;
+    static constexpr int WORLD_VOL = WORLD_AREA * WORLD_H;
+
+    // in blocks, the last chunks of a size that does not divide them are left empty past them
+    static constexpr int BLOCKS_W = ::WORLD_W * CHUNK_SIZE;
+    static constexpr int BLOCKS_H = ::WORLD_H * CHUNK_SIZE;
+    static constexpr int BLOCKS_D = ::WORLD_D * CHUNK_SIZE;
+
+    static constexpr int bit_width(unsigned v) { return v ? 1 + bit_width(v >> 1) : 0; }
+
+    // vertex coordinates go from 0 to Size inclusive
+    static constexpr int COORD_BITS = bit_width(Size);
+    static constexpr int VERTEX_BITS = 3 * COORD_BITS + 8 + 3 + 2 + 1;
+
+    using Vertex = std::conditional_t<VERTEX_BITS <= 32, uint32_t, uint64_t>;
+    using Voxels = std::array<uint8_t, VOL>;
+    using WorldVoxels = std::array<std::unique_ptr<Voxels>, WORLD_VOL>;
+
+    static int index(int x, int y, int z) { return x + Size * z + AREA * y; }
+
+    // world position to chunk index, -1 if outside of the world
+    static int chunk_index(int wx, int wy, int wz) {
+        int cx = wx / Size;
+        int cy = wy / Size;
+        int cz = wz / Size;
+        if (wx < 0 || cx >= WORLD_W || wy < 0 || cy >= WORLD_H || wz < 0 || cz >= WORLD_D) return -1;
+
+        return cx + WORLD_W * cz + WORLD_AREA * cy;
+    }
+
+    // world position to voxel index inside its chunk
+    static int voxel_index(int wx, int wy, int wz) { return index(wx % Size, wy % Size, wz % Size); }
+
+    // from the most significant bit: x, y, z, voxel_id, face_id, ao_id, flip_id (see chunk.vert)
+    static Vertex pack(int x, int y, int z, uint8_t voxel_id, uint8_t face_id, uint8_t ao_id, uint8_t flip_id) {
+        Vertex data = x;
+        data = data << COORD_BITS | y;
+        data = data << COORD_BITS | z;
+        data = data << 8 | voxel_id;
+        data = data << 3 | face_id;
+        data = data << 2 | ao_id;
+        return data << 1 | flip_id;
+    }
+
+    static glm::ivec3 unpack_position(Vertex data) {
+        constexpr Vertex mask = (1 << COORD_BITS) - 1;
+        return {(int)(data >> (2 * COORD_BITS + 14) & mask), (int)(data >> (COORD_BITS + 14) & mask),
+                (int)(data >> 14 & mask)};
+    }
+
+    static constexpr bool is_water(uint8_t voxel_id) { return voxel_id >= WATER && voxel_id < WATER + WATER_LEVELS; }
+    // cutout blocks are meshed apart, so the opaque ones can be drawn without blending
+    static constexpr bool is_translucent(uint8_t voxel_id) { return voxel_id == LEAVES || is_water(voxel_id); }
+
+    struct Mesh {
+        std::vector<Vertex> opaque;
+        std::vector<Vertex> translucent;  // quads of 6 vertices each, sorted back to front before drawing
+    };
+
+    static Mesh build_mesh(const WorldVoxels& world_voxels, int cx, int cy, int cz);
+
+    // the far field DAG of columns x columns chunk columns, starting at the column cx, cz
+    static int dag_levels(int columns) { return bit_width(std::max(columns, WORLD_H) * Size - 1); }
+    static VoxelDag build_dag(const WorldVoxels& world_voxels, int cx, int cz, int columns);
+};
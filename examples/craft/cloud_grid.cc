@@ -0,0 +1,96 @@
+#include "cloud_grid.h"
+
+#include <algorithm>
+#include <glm/gtc/noise.hpp>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+inline int count_trailing_zeros(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return (int)index;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+// bits [x, x + w) of a word, w <= 64 - x
+inline uint64_t word_mask(int x, int w) { return (w == 64 ? ~uint64_t(0) : (uint64_t(1) << w) - 1) << x; }
+
+// number of set cells starting at x
+int run_length(const uint64_t* row, int x, int width) {
+    int end = x;
+    while (end < width) {
+        // cells past the width are never set, so the run stops there
+        uint64_t holes = ~row[end / 64] >> (end % 64);
+        if (holes) return end + count_trailing_zeros(holes) - x;
+        end += 64 - end % 64;
+    }
+    return width - x;
+}
+
+// are the cells [x, x + w) all set?
+bool all_set(const uint64_t* row, int x, int w) {
+    for (int end = x + w; x < end;) {
+        int n = std::min(end - x, 64 - x % 64);
+        uint64_t mask = word_mask(x % 64, n);
+        if ((row[x / 64] & mask) != mask) return false;
+        x += n;
+    }
+    return true;
+}
+
+void clear(uint64_t* row, int x, int w) {
+    for (int end = x + w; x < end;) {
+        int n = std::min(end - x, 64 - x % 64);
+        row[x / 64] &= ~word_mask(x % 64, n);
+        x += n;
+    }
+}
+}  // namespace
+
+void CloudGrid::gen_clouds() {
+#pragma omp parallel for
+    for (int z = 0; z < depth; ++z)
+        for (int x = 0; x < width; ++x) {
+            if (glm::simplex(glm::vec2(0.13 * x, 0.13 * z)) < 0.2) continue;
+            set(x, z);
+        }
+}
+
+std::vector<CloudGrid::Quad> CloudGrid::merge_quads(int strips) const {
+    std::vector<std::vector<Quad>> strip_quads(strips);
+
+#pragma omp parallel for
+    for (int strip = 0; strip < strips; ++strip) {
+        int z_begin = depth * strip / strips, z_end = depth * (strip + 1) / strips;
+
+        // cells not merged yet
+        std::vector<uint64_t> left(bits.begin() + words * z_begin, bits.begin() + words * z_end);
+        auto row = [&](int z) { return left.data() + words * (z - z_begin); };
+        auto& quads = strip_quads[strip];
+
+        for (int z = z_begin; z < z_end; ++z)
+            for (int i = 0; i < words; ++i)
+                while (row(z)[i]) {
+                    int x = i * 64 + count_trailing_zeros(row(z)[i]);
+
+                    // continuous cells along x, then rows below while all of them are left
+                    int w = run_length(row(z), x, width);
+                    int d = 1;
+                    while (z + d < z_end && all_set(row(z + d), x, w)) ++d;
+
+                    for (int iz = z; iz < z + d; ++iz) clear(row(iz), x, w);
+
+                    quads.push_back({x, z, w, d});
+                }
+    }
+
+    std::vector<Quad> quads;
+    for (auto& strip : strip_quads) quads.insert(quads.end(), strip.begin(), strip.end());
+    return quads;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// One bit per cloud cell, every row starts on a new word so rows can be written in parallel.
+struct CloudGrid {
+    CloudGrid(int width, int depth) : width(width), depth(depth), words((width + 63) / 64), bits(words * depth) {}
+
+    // cell rectangle, x/z of the first cell and the number of cells along each axis
+    struct Quad {
+        int x, z, w, d;
+        bool operator==(const Quad& other) const {
+            return x == other.x && z == other.z && w == other.w && d == other.d;
+        }
+    };
+
+    bool test(int x, int z) const { return bits[words * z + x / 64] >> (x % 64) & 1; }
+    void set(int x, int z) { bits[words * z + x / 64] |= uint64_t(1) << (x % 64); }
+
+    void gen_clouds();
+
+    // Greedy merge of the set cells into quads, scanning rows from the top and extending along x first.
+    // Rows are split into `strips` independent strips merged in parallel, quads do not cross them.
+    std::vector<Quad> merge_quads(int strips = 1) const;
+
+    int width, depth;
+    int words;  // per row
+    std::vector<uint64_t> bits;
+};
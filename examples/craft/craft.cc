@@ -2,12 +2,13 @@
 
 #include "engine.h"
 #include "meshes/cloud_mesh.h"
+#include "meshes/cloud_slab.h"
 #include "meshes/water_mesh.h"
 #include "settings.h"
 #include "world.h"
 
 struct McScene : Scene {
-    McScene(Engine& engine) : world(std::make_unique<World>(engine)) {}
+    McScene(Engine& engine) : engine(engine), world(std::make_unique<World>(engine)) {}
 
     virtual void init() override {
         world->init();
@@ -23,8 +24,14 @@ struct McScene : Scene {
     }
 
     virtual void load() override { world->load(); }
-    virtual void attach() override { world->attach(); }
+    virtual void attach() override {
+        // the shadow cascades come before the main pass
+        world->shadows->attach();
+        engine.vulkan.addRenderPass();
+        world->attach();
+    }
 
+    Engine& engine;
     std::unique_ptr<World> world;
 };
 
@@ -38,6 +45,8 @@ struct McPlayer : public Player {
                 engine.get_scene<McScene>().world->voxel_handler->set_voxel();
             } else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
                 engine.get_scene<McScene>().world->voxel_handler->switch_mode();
+            } else if (button == GLFW_MOUSE_BUTTON_MIDDLE) {
+                engine.get_scene<McScene>().world->voxel_handler->switch_voxel();
             }
         }
     }
@@ -45,16 +54,45 @@ struct McPlayer : public Player {
     Engine& engine;
 };
 
+struct WorldGui : Gui {
+    WorldGui(const World& world) : Gui("World"), world(world) {}
+    virtual void gui_draw() override {
+        for (int stage = WorldGen::TERRAIN; stage < WorldGen::STAGE_COUNT; ++stage)
+            ImGui::Text("Generation %s: %.2f ms", WorldGen::stage_name((WorldGen::Stage)stage),
+                        world.gen.stage_times[stage]);
+        ImGui::Text("Draw calls: %u in %zu regions", world.draw_calls, world.regions.size());
+        ImGui::Text("Voxels: %.1f MB resident, %.1f MB compressed", world.storage.resident_bytes() / 1048576.0f,
+                    world.storage.compressed_bytes / 1048576.0f);
+        ImGui::Text("Far field DAG: %.1f MB, dense voxels: %.1f MB", world.dag_bytes() / 1048576.0f,
+                    WORLD_VOL * sizeof(ChunkMesh::Voxels) / 1048576.0f);
+        ImGui::Text("Water: %zu cells, %zu active, tick %.2f ms", world.fluid->water_cells.load(),
+                    world.fluid->active_cells.load(), world.fluid->tick_time.load());
+        if (world.far_field)
+            ImGui::Text("Far field: %d of %zu regions meshed, grid %.1f MB", world.far_field->near_count,
+                        world.regions.size(), world.far_field->grid.memory_bytes() / 1048576.0f);
+        for (int i = 0; i < SHADOW_CASCADES; ++i) {
+            auto& cascade = world.shadows->cascades.cascades[i];
+            ImGui::Text("Shadow cascade %d: %.0f blocks, %u draws, %u vertices, %.2f ms%s", i, cascade.split,
+                        cascade.draw_calls, cascade.vertices, cascade.record_time, cascade.redraw ? "" : ", kept");
+        }
+    }
+
+    const World& world;
+};
+
 int main(int argc, char* argv[]) {
     try {
-        Engine engine(WIN_WIDTH, WIN_HEIGHT);
+        Engine engine(WIN_WIDTH, WIN_HEIGHT, SHADOW_CASCADES + 1);
         engine.set_bg_color({BG_COLOR.r, BG_COLOR.g, BG_COLOR.b, 1.0});
 
         engine.set_player(std::make_unique<McPlayer>(engine));
         engine.set_scene(std::make_unique<McScene>(engine));
-        engine.add_mesh(std::make_unique<CloudMesh>(engine));
+        engine.add_gui(std::make_unique<WorldGui>(*engine.get_scene<McScene>().world));
+        if (PROCEDURAL_CLOUDS)
+            engine.add_mesh(std::make_unique<CloudSlab>(engine));
+        else
+            engine.add_mesh(std::make_unique<CloudMesh>(engine));
         engine.add_mesh(std::make_unique<WaterMesh>(engine));
-        engine.vulkan.addRenderPass();
 
         engine.run();
     } catch (const std::exception& e) {
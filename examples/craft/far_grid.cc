@@ -0,0 +1,27 @@
+#include "far_grid.h"
+
+#include <algorithm>
+
+void FarGrid::update_brick(glm::ivec3 cell, int level) {
+    int size = brick_size(level);
+    auto lo = cell / size * size;
+    glm::ivec3 hi(std::min(lo.x + size, width), std::min(lo.y + size, height), std::min(lo.z + size, depth));
+
+    // a brick is empty when all the cells, or all the bricks one level down, are
+    int step = brick_size(level - 1);
+    bool empty = true;
+    for (int y = lo.y; y < hi.y && empty; y += step)
+        for (int z = lo.z; z < hi.z && empty; z += step)
+            for (int x = lo.x; x < hi.x && empty; x += step) {
+                glm::ivec3 inner(x, y, z);
+                empty = level == 1 ? !voxel_id(inner) : is_empty_brick(inner, level - 1);
+            }
+
+    uint32_t flag = (empty ? 0xffu : 0) << (8 * level), mask = ~(0xffu << (8 * level));
+    for (int y = lo.y; y < hi.y; ++y)
+        for (int z = lo.z; z < hi.z; ++z)
+            for (int x = lo.x; x < hi.x; ++x) {
+                auto& texel = texels[index(glm::ivec3(x, y, z))];
+                texel = (texel & mask) | flag;
+            }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Coarse occupancy of the world for the far field pass, one RGBA8 texel per cell of cell_size^3 voxels.
+// r is the voxel id showing on top of the cell, g and b flag the empty bricks of BRICK^1 and BRICK^2 cells
+// around it, so far_field.frag can skip them in one step.
+struct FarGrid {
+    static constexpr int BRICK = 4;   // cells per brick side
+    static constexpr int LEVELS = 2;  // brick levels above the cells
+
+    FarGrid(int width, int height, int depth, int cell_size)
+        : width(width), height(height), depth(depth), cell_size(cell_size), texels(width * height * depth) {}
+
+    // get_voxel(wx, wy, wz) for every voxel of the world
+    template <typename GetVoxel>
+    void build(GetVoxel get_voxel) {
+#pragma omp parallel for
+        for (int i = 0; i < width * depth; ++i)
+            for (int y = 0; y < height; ++y) {
+                glm::ivec3 cell(i % width, y, i / width);
+                texels[index(cell)] = 0xff000000 | cell_voxel(get_voxel, cell);
+            }
+
+        for (int level = 1; level <= LEVELS; ++level) {
+            int size = brick_size(level);
+            for (int z = 0; z < depth; z += size)
+                for (int y = 0; y < height; y += size)
+                    for (int x = 0; x < width; x += size) update_brick(glm::ivec3(x, y, z), level);
+        }
+    }
+
+    // after a voxel edit, only its cell and the bricks around it change, returns false when the cell did not
+    template <typename GetVoxel>
+    bool update(GetVoxel get_voxel, glm::ivec3 world_pos) {
+        auto cell = world_pos / cell_size;
+        auto& texel = texels[index(cell)];
+        auto voxel_id = cell_voxel(get_voxel, cell);
+        if ((texel & 0xff) == voxel_id) return false;
+        texel = (texel & ~0xffu) | voxel_id;
+
+        for (int level = 1; level <= LEVELS; ++level) update_brick(cell, level);
+        return true;
+    }
+
+    // the cells update() may change around a cell are those of its top level brick, from lo to hi exclusive
+    void top_brick(glm::ivec3 cell, glm::ivec3& lo, glm::ivec3& hi) const {
+        int size = brick_size(LEVELS);
+        lo = cell / size * size;
+        hi = glm::min(lo + size, glm::ivec3(width, height, depth));
+    }
+    // packed as the texture, by layer then by row
+    std::vector<uint32_t> copy_box(glm::ivec3 lo, glm::ivec3 hi) const {
+        std::vector<uint32_t> box;
+        box.reserve(size_t(hi.x - lo.x) * (hi.y - lo.y) * (hi.z - lo.z));
+        for (int y = lo.y; y < hi.y; ++y)
+            for (int z = lo.z; z < hi.z; ++z) {
+                auto row = texels.data() + index(glm::ivec3(lo.x, y, z));
+                box.insert(box.end(), row, row + (hi.x - lo.x));
+            }
+        return box;
+    }
+
+    uint8_t voxel_id(glm::ivec3 cell) const { return texels[index(cell)] & 0xff; }
+    bool is_empty_brick(glm::ivec3 cell, int level) const { return texels[index(cell)] >> (8 * level) & 0xff; }
+
+    static int brick_size(int level) { return level == 0 ? 1 : BRICK * brick_size(level - 1); }
+    size_t memory_bytes() const { return texels.size() * sizeof(uint32_t); }
+
+    int width, height, depth;  // in cells
+    int cell_size;             // in voxels
+    std::vector<uint32_t> texels;  // layer y, row z, column x, so the grid uploads as a texture array
+
+   private:
+    int index(glm::ivec3 cell) const { return cell.x + width * (cell.z + depth * cell.y); }
+
+    // the first voxel met going down through the cell, as seen from above
+    template <typename GetVoxel>
+    uint8_t cell_voxel(GetVoxel& get_voxel, glm::ivec3 cell) const {
+        auto origin = cell * cell_size;
+        for (int y = cell_size - 1; y >= 0; --y)
+            for (int z = 0; z < cell_size; ++z)
+                for (int x = 0; x < cell_size; ++x)
+                    if (uint8_t voxel_id = get_voxel(origin.x + x, origin.y + y, origin.z + z)) return voxel_id;
+        return 0;
+    }
+
+    // refreshes the empty flag of the level brick containing cell
+    void update_brick(glm::ivec3 cell, int level);
+};
@@ -0,0 +1,160 @@
+#include "fluid_sim.h"
+
+#include <cassert>
+#include <chrono>
+
+namespace {
+const glm::ivec3 UP(0, 1, 0);
+const std::array<glm::ivec3, 4> SIDES = {glm::ivec3(1, 0, 0), glm::ivec3(-1, 0, 0), glm::ivec3(0, 0, 1),
+                                         glm::ivec3(0, 0, -1)};
+}  // namespace
+
+FluidSim::FluidSim(int width, int height, int depth, size_t tick_budget)
+    : width(width),
+      height(height),
+      depth(depth),
+      tick_budget(tick_budget),
+      solid(((size_t)width * height * depth + 63) / 64) {
+    // init() fills the layers in parallel, they must not share a word
+    assert(width * depth % 64 == 0);
+
+    worker = std::thread(&FluidSim::work, this);
+}
+
+FluidSim::~FluidSim() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    cv.notify_one();
+    worker.join();
+}
+
+void FluidSim::set_voxel(glm::ivec3 pos, uint8_t voxel_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    edits.emplace_back(pos, voxel_id);
+}
+
+std::vector<FluidSim::Change> FluidSim::update(float dt) {
+    std::vector<Change> result;
+    std::lock_guard<std::mutex> lock(mutex);
+    result.swap(changes);
+
+    // a late tick is not queued twice
+    since_tick += dt;
+    if (since_tick >= FLUID_TICK_SECONDS && !tick_requested) {
+        since_tick = 0;
+        tick_requested = true;
+        cv.notify_one();
+    }
+    return result;
+}
+
+void FluidSim::step() {
+    auto start = std::chrono::steady_clock::now();
+
+    decltype(edits) new_edits;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        new_edits.swap(edits);
+    }
+    for (auto& [pos, voxel_id] : new_edits) {
+        if (!inside(pos)) continue;
+
+        int i = index(pos);
+        auto bit = uint64_t(1) << (i % 64);
+        bool is_water = Chunk<CHUNK_SIZE>::is_water(voxel_id);
+        if (voxel_id && !is_water)
+            solid[i / 64] |= bit;
+        else
+            solid[i / 64] &= ~bit;
+        if (is_water)
+            water[i] = voxel_id - WATER;
+        else
+            water.erase(i);
+
+        activate(pos);
+        activate_neighbors(pos);
+    }
+
+    // only the cells active when the tick starts, so water moves one block per tick
+    std::vector<Change> tick_changes;
+    for (size_t count = std::min(active.size(), tick_budget); count; --count) {
+        auto pos = active.front();
+        active.pop_front();
+        queued.erase(index(pos));
+
+        // still water only changes by edits
+        int current = level(pos);
+        if (is_solid(pos) || current == 0) continue;
+
+        int wanted = flow_level(pos);
+        if (wanted == current) continue;
+
+        if (wanted == -1)
+            water.erase(index(pos));
+        else
+            water[index(pos)] = wanted;
+        tick_changes.push_back({pos, (uint8_t)(wanted == -1 ? 0 : WATER + wanted)});
+        activate_neighbors(pos);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        changes.insert(changes.end(), tick_changes.begin(), tick_changes.end());
+    }
+    active_cells = active.size();
+    water_cells = water.size();
+    tick_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool FluidSim::is_solid(glm::ivec3 pos) const {
+    int i = index(pos);
+    return solid[i / 64] >> (i % 64) & 1;
+}
+
+int FluidSim::level(glm::ivec3 pos) const {
+    if (!inside(pos)) return -1;
+
+    auto it = water.find(index(pos));
+    return it == water.end() ? -1 : it->second;
+}
+
+int FluidSim::flow_level(glm::ivec3 pos) const {
+    if (level(pos + UP) != -1) return 1;
+
+    // water only spreads sideways from where it rests on a block or on still water
+    int lowest = WATER_LEVELS;
+    for (auto& side : SIDES) {
+        auto neighbor = pos + side;
+        int neighbor_level = level(neighbor);
+        if (neighbor_level == -1) continue;
+
+        auto below = neighbor - UP;
+        if (!inside(below) || is_solid(below) || level(below) == 0) lowest = std::min(lowest, neighbor_level);
+    }
+    return lowest + 1 < WATER_LEVELS ? lowest + 1 : -1;
+}
+
+void FluidSim::activate(glm::ivec3 pos) {
+    if (inside(pos) && queued.insert(index(pos)).second) active.push_back(pos);
+}
+
+void FluidSim::activate_neighbors(glm::ivec3 pos) {
+    activate(pos + UP);
+    activate(pos - UP);
+    for (auto& side : SIDES) activate(pos + side);
+}
+
+void FluidSim::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cv.wait(lock, [this]() { return quit || tick_requested; });
+        if (quit) return;
+
+        lock.unlock();
+        step();
+        lock.lock();
+        tick_requested = false;
+    }
+}
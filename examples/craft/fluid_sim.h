@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "chunk.h"
+
+// Cellular water. Still water (a source) stays put, flowing water is recomputed from its neighbors:
+// level 1 under any water, otherwise one more than the lowest level next to it that rests on something.
+// Past WATER_LEVELS - 1 it dries up, so flows retract on their own once their source is gone.
+// Only the cells on the active list are visited, a cell that changes activates its neighbors,
+// so the cost of a tick follows the flowing water and not the world.
+// Ticks run on a worker thread with their own copy of the solid voxels, edits are forwarded with
+// set_voxel() and the changed cells are collected with update(), both on the main thread.
+struct FluidSim {
+    struct Change {
+        glm::ivec3 pos;
+        uint8_t voxel_id;  // 0 or water
+    };
+
+    FluidSim(int width, int height, int depth, size_t tick_budget = FLUID_TICK_BUDGET);
+    ~FluidSim();
+
+    // get_voxel(wx, wy, wz) for every voxel of the world, before the first tick
+    template <typename GetVoxel>
+    void init(GetVoxel get_voxel) {
+#pragma omp parallel for
+        for (int y = 0; y < height; ++y)
+            for (int z = 0; z < depth; ++z)
+                for (int x = 0; x < width; ++x) {
+                    uint8_t voxel_id = get_voxel(x, y, z);
+                    int i = index(glm::ivec3(x, y, z));
+                    if (Chunk<CHUNK_SIZE>::is_water(voxel_id)) {
+#pragma omp critical
+                        water[i] = voxel_id - WATER;
+                    } else if (voxel_id)
+                        solid[i / 64] |= uint64_t(1) << (i % 64);
+                }
+    }
+
+    // an edit of the world, the cells around it are simulated again
+    void set_voxel(glm::ivec3 pos, uint8_t voxel_id);
+
+    // the cells changed since the last call, starts a new tick every FLUID_TICK_SECONDS
+    std::vector<Change> update(float dt);
+
+    // a single tick on the calling thread, the worker runs the same
+    void step();
+
+    std::atomic<size_t> active_cells{0};
+    std::atomic<size_t> water_cells{0};
+    std::atomic<float> tick_time{0};  // in milliseconds
+
+    int width, height, depth;
+
+   private:
+    int index(glm::ivec3 pos) const { return pos.x + width * (pos.z + depth * pos.y); }
+    bool inside(glm::ivec3 pos) const {
+        return pos.x >= 0 && pos.x < width && pos.y >= 0 && pos.y < height && pos.z >= 0 && pos.z < depth;
+    }
+    bool is_solid(glm::ivec3 pos) const;
+    int level(glm::ivec3 pos) const;  // -1 without water
+    int flow_level(glm::ivec3 pos) const;
+    void activate(glm::ivec3 pos);
+    void activate_neighbors(glm::ivec3 pos);
+    void work();
+
+    size_t tick_budget;  // cells per tick
+    float since_tick = 0;
+
+    // only touched by the tick
+    std::vector<uint64_t> solid;             // a bit per voxel
+    std::unordered_map<int, uint8_t> water;  // level per cell, 0 is still water
+    std::deque<glm::ivec3> active;
+    std::unordered_set<int> queued;          // in active
+
+    // shared with the worker
+    std::vector<std::pair<glm::ivec3, uint8_t>> edits;
+    std::vector<Change> changes;
+    bool tick_requested = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool quit = false;
+    std::thread worker;
+};
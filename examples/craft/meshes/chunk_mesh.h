@@ -1,29 +1,32 @@
 #pragma once
 
-#include "settings.h"
-#include "shader.h"
+#include "camera.h"
+#include "chunk.h"
 
 struct World;
-struct ChunkMesh : Shader {
-    ChunkMesh() = default;
-    ChunkMesh(Engine& engine, World* world, glm::vec3 pos);
-    virtual ~ChunkMesh() override;
+struct RegionMesh;
+// Chunks only keep their CPU side mesh, the vertex buffers live in their regions.
+struct ChunkMesh {
+    ChunkMesh(World* world, glm::vec3 pos);
 
-    virtual void init() override;
-    virtual void attach(uint32_t subpass = 0) override;
+    using Vertex = Chunk<CHUNK_SIZE>::Vertex;
+    using Voxels = Chunk<CHUNK_SIZE>::Voxels;
 
-    using Vertex = uint32_t;
-    using Voxels = std::array<uint8_t, CHUNK_VOL>;
+    // chunk.vert unpacks 6 bit coordinates from a single R32 attribute
+    static_assert(Chunk<CHUNK_SIZE>::COORD_BITS == 6 && sizeof(Vertex) == 4);
 
-    std::unique_ptr<Voxels> build_voxels();
-    std::vector<Vertex> build_mesh();
+    // needs the voxels of the chunk and of its neighbors resident
+    void build_mesh();
+    // makes them resident, nothing while its region is far
     void rebuild_mesh();
-    bool is_on_frustum(const Camera& camera);
+    Voxels& get_voxels();
+    bool is_on_frustum(const Camera& camera) const;
 
     World* world;
+    RegionMesh* region = nullptr;
     bool empty = true;
     glm::vec3 position;
     glm::vec3 center;
-    glm::mat4 model;
-    Voxels* voxels;
+    int index;
+    Chunk<CHUNK_SIZE>::Mesh mesh;
 };
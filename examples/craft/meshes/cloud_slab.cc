@@ -0,0 +1,39 @@
+#include "cloud_slab.h"
+
+#include "engine.h"
+
+CloudSlab::CloudSlab(Engine& engine) : engine(engine), Shader("clouds_slab", engine) {
+    vert_formats = {vk::Format::eR32G32B32Sfloat};
+    // back faces only, so it also works from inside the slab
+    cull_mode = vk::CullModeFlagBits::eFront;
+}
+
+void CloudSlab::init() {
+    Shader::init();
+
+    constexpr std::array<std::tuple<float, float, float>, 8> vertices = {
+        std::tuple<float, float, float>{0.0f, 0.0f, 1.0f},
+        {1.0f, 0.0f, 1.0f},
+        {1.0f, 1.0f, 1.0f},
+        {0.0f, 1.0f, 1.0f},
+        {0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f},
+        {1.0f, 0.0f, 0.0f},
+        {1.0f, 1.0f, 0.0f}};
+    constexpr std::array<size_t, 36> indices = {0, 2, 3, 0, 1, 2, 1, 7, 2, 1, 6, 7, 6, 5, 4, 4, 7, 6,
+                                                3, 4, 5, 3, 5, 0, 3, 7, 4, 3, 2, 7, 0, 6, 1, 0, 5, 6};
+
+    // the scaled cloud grid, plus the drift of the clouds
+    Layout layout = {glm::vec2(CENTER_XZ), CLOUD_SCALE, WORLD_W * CHUNK_SIZE, CLOUD_HEIGHT,
+                     CLOUD_HEIGHT + CLOUD_THICKNESS};
+    float lo = (0 - CENTER_XZ) * CLOUD_SCALE + CENTER_XZ - 300;
+    float hi = (layout.grid_size - CENTER_XZ) * CLOUD_SCALE + CENTER_XZ + 300;
+
+    auto box = hstack<Vertex>(get_data(vertices, indices));
+    for (auto& vertex : box)
+        vertex = glm::vec3(lo, layout.bottom, lo) + vertex * glm::vec3(hi - lo, layout.top - layout.bottom, hi - lo);
+    write_vertex(box);
+
+    write_uniform(3, BG_COLOR, vk::ShaderStageFlagBits::eFragment);
+    write_uniform(4, layout, vk::ShaderStageFlagBits::eFragment);
+}
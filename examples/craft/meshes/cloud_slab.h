@@ -0,0 +1,25 @@
+#pragma once
+
+#include "settings.h"
+#include "shader.h"
+
+// Procedural clouds: a single box around the cloud layer, clouds_slab.frag marches the view ray
+// through it and evaluates the same noise as the cloud mesh, so nothing is built on the CPU.
+struct CloudSlab : Shader {
+    CloudSlab(Engine& engine);
+
+    virtual void init() override;
+
+    using Vertex = glm::vec3;
+
+    // mirrors the cloud_layout_t block of clouds_slab.frag
+    struct Layout {
+        glm::vec2 center;
+        float scale;
+        float grid_size;
+        float bottom;
+        float top;
+    };
+
+    Engine& engine;
+};
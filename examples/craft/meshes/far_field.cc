@@ -0,0 +1,103 @@
+#include "far_field.h"
+
+#include <algorithm>
+
+#include "world.h"
+
+FarFieldMesh::FarFieldMesh(Engine& engine, World& world)
+    : Shader("far_field", engine),
+      world(world),
+      grid(WORLD_W * CHUNK_SIZE / FAR_CELL_SIZE, WORLD_H * CHUNK_SIZE / FAR_CELL_SIZE,
+           WORLD_D * CHUNK_SIZE / FAR_CELL_SIZE, FAR_CELL_SIZE) {
+    vert_formats = {vk::Format::eR32G32B32Sfloat};
+    // back faces only, so it also works from inside the world
+    cull_mode = vk::CullModeFlagBits::eFront;
+}
+
+FarFieldMesh::~FarFieldMesh() {
+    // erase it to avoid double free
+    textures.erase(4);
+}
+
+void FarFieldMesh::init() {
+    Shader::init();
+
+    constexpr std::array<std::tuple<float, float, float>, 8> vertices = {
+        std::tuple<float, float, float>{0.0f, 0.0f, 1.0f},
+        {1.0f, 0.0f, 1.0f},
+        {1.0f, 1.0f, 1.0f},
+        {0.0f, 1.0f, 1.0f},
+        {0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f},
+        {1.0f, 0.0f, 0.0f},
+        {1.0f, 1.0f, 0.0f}};
+    constexpr std::array<size_t, 36> indices = {0, 2, 3, 0, 1, 2, 1, 7, 2, 1, 6, 7, 6, 5, 4, 4, 7, 6,
+                                                3, 4, 5, 3, 5, 0, 3, 7, 4, 3, 2, 7, 0, 6, 1, 0, 5, 6};
+
+    auto box = hstack<Vertex>(get_data(vertices, indices));
+    for (auto& vertex : box) vertex *= glm::vec3(WORLD_W, WORLD_H, WORLD_D) * (float)CHUNK_SIZE;
+    write_vertex(box);
+
+    layout.grid_size = glm::ivec3(grid.width, grid.height, grid.depth);
+    layout.cell_size = FAR_CELL_SIZE;
+    layout.region_size = REGION_SIZE * CHUNK_SIZE;
+    layout.regions_w = (WORLD_W + REGION_SIZE - 1) / REGION_SIZE;
+    write_uniform(2, layout, vk::ShaderStageFlagBits::eFragment);
+    write_uniform(3, BG_COLOR, vk::ShaderStageFlagBits::eFragment);
+
+    // stolen from world, the last mip of a block is its average color
+    textures[4] = world.textures.at(4);
+
+    // from the dense voxels, before any chunk goes cold
+    grid.build([&](int wx, int wy, int wz) {
+        using C = Chunk<CHUNK_SIZE>;
+        return (*world.voxels[C::chunk_index(wx, wy, wz)])[C::voxel_index(wx, wy, wz)];
+    });
+    // texelFetch only, so a single level without filtering
+    auto texels = reinterpret_cast<const char*>(grid.texels.data());
+    textures[5] = vulkan->createTexture(
+        vk::Format::eR8G8B8A8Unorm, {(uint32_t)grid.width, (uint32_t)grid.depth},
+        {std::vector<char>(texels, texels + grid.memory_bytes())}, grid.height, false, false, vk::Filter::eNearest,
+        vk::Filter::eNearest, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge);
+}
+
+void FarFieldMesh::update() {
+    Shader::update();
+
+    near_count = 0;
+    layout.near_regions = {};
+    for (auto& region : world.regions) {
+        if (!region->near) continue;
+        ++near_count;
+
+        int i = region->origin.x / layout.region_size + layout.regions_w * (region->origin.z / layout.region_size);
+        layout.near_regions[i / 128][i / 32 % 4] |= 1u << (i % 32);
+    }
+    write_uniform(2, layout);
+
+    // only the top level bricks around the edited cells
+    for (auto& brick : dirty_bricks) {
+        glm::ivec3 lo, hi;
+        grid.top_brick(brick, lo, hi);
+        auto box = grid.copy_box(lo, hi);
+        update_texture(5, {lo.x, lo.z}, {uint32_t(hi.x - lo.x), uint32_t(hi.z - lo.z)}, lo.y, hi.y - lo.y,
+                       box.data());
+    }
+    dirty_bricks.clear();
+}
+
+void FarFieldMesh::set_voxel(glm::ivec3 world_pos) {
+    // the chunk voxels may be compressed, the region DAGs are always resident
+    bool changed = grid.update(
+        [&](int wx, int wy, int wz) {
+            auto region = world.chunks[Chunk<CHUNK_SIZE>::chunk_index(wx, wy, wz)]->region;
+            return region->dag.get(glm::ivec3(wx, wy, wz) - region->origin);
+        },
+        world_pos);
+    if (!changed) return;
+
+    glm::ivec3 lo, hi;
+    grid.top_brick(world_pos / FAR_CELL_SIZE, lo, hi);
+    if (std::find(dirty_bricks.begin(), dirty_bricks.end(), lo) == dirty_bricks.end()) dirty_bricks.push_back(lo);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "far_grid.h"
+#include "settings.h"
+#include "shader.h"
+
+struct World;
+
+// Far field: a box around the world, far_field.frag marches the view ray through the FarGrid and
+// writes the depth of the hit, so it composites with the meshed regions through the depth test.
+// Regions within FAR_FIELD_RADIUS are meshed, the ones with all their chunks meshed are flagged in the layout and
+// skipped by the march.
+struct FarFieldMesh : Shader {
+    FarFieldMesh(Engine& engine, World& world);
+    virtual ~FarFieldMesh() override;
+
+    virtual void init() override;
+    virtual void update() override;
+
+    // once the region DAG has the edit, only the changed bricks of the grid are uploaded by update()
+    void set_voxel(glm::ivec3 world_pos);
+
+    using Vertex = glm::vec3;
+
+    // mirrors the far_field_t block of far_field.frag
+    struct Layout {
+        std::array<glm::uvec4, MAX_REGIONS / 128> near_regions;  // a bit per region, set when it is meshed
+        glm::ivec3 grid_size;                                    // in cells
+        int cell_size;                                           // in blocks
+        int region_size;                                         // in blocks
+        int regions_w;
+    };
+
+    World& world;
+    FarGrid grid;
+    Layout layout = {};
+    int near_count = 0;  // meshed regions in the last frame
+    std::vector<glm::ivec3> dirty_bricks;  // the first cells of the top level bricks changed since the last upload
+};
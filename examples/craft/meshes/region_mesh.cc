@@ -0,0 +1,238 @@
+#include "region_mesh.h"
+
+#include "radix_sort.h"
+#include "world.h"
+
+RegionMesh::RegionMesh(Engine& engine, World* world) : Shader("chunk", engine), world(world) {
+    vert_formats = {vk::Format::eR32Uint};
+}
+
+RegionMesh::~RegionMesh() {
+    // erase them to avoid double free
+    uniforms.erase(3);
+    uniforms.erase(5);
+
+    vulkan->destroyDynamicVertexBuffer(translucent);
+    vulkan->destroyUniformBuffer(translucent_table);
+}
+
+void RegionMesh::init() {
+    // no need to call Shader::init();
+    // stolen them from world
+    uniforms[3] = world->uniforms[3];
+    uniforms[5] = world->uniforms[5];
+
+    translucent_table = vulkan->createUniformBuffer(sizeof(ChunkTable));
+
+    center = glm::vec3(0);
+    for (auto chunk : chunks) center += chunk->center / (float)chunks.size();
+
+    rebuild();
+}
+
+void RegionMesh::build_dag() {
+    // the chunks are ordered by column, so the first one is in the corner
+    auto corner = glm::ivec3(chunks.front()->position);
+    origin = corner * CHUNK_SIZE;
+    dag = Chunk<CHUNK_SIZE>::build_dag(world->voxels, corner.x, corner.z, REGION_SIZE);
+}
+
+void RegionMesh::set_voxel(glm::ivec3 world_pos, uint8_t voxel_id) {
+    using C = Chunk<CHUNK_SIZE>;
+    auto previous = dag.get(world_pos - origin);
+    if (previous == voxel_id) return;
+    dag.set(world_pos - origin, voxel_id);
+
+    // the far field shows all the water levels alike, flowing water does not change it
+    if (C::is_water(previous) && C::is_water(voxel_id)) return;
+    if (world->far_field) world->far_field->set_voxel(world_pos);
+}
+
+void RegionMesh::set_meshed(bool meshed) {
+    this->meshed = meshed;
+    next_chunk = 0;
+    // meshed over the next frames by mesh_chunks(), the far field draws it meanwhile
+    if (meshed) return;
+
+    near = false;
+    for (auto chunk : chunks) chunk->mesh = {};
+    dirty = true;
+}
+
+int RegionMesh::mesh_chunks(int budget) {
+    for (; next_chunk < chunks.size() && budget > 0; ++next_chunk) {
+        if (chunks[next_chunk]->empty) continue;
+        chunks[next_chunk]->rebuild_mesh();
+        --budget;
+    }
+    if (next_chunk == chunks.size()) {
+        near = true;
+        dirty = true;
+    }
+    return budget;
+}
+
+void RegionMesh::attach(uint32_t subpass) {
+    // the vertex buffers may still be empty, so give the stride explicitly
+    draw_id = vulkan->attachShader(world->vert_shader, world->frag_shader, sizeof(ChunkMesh::Vertex), vert_formats,
+                                   uniforms, world->textures, subpass, cull_mode, false, false);
+
+    auto translucent_uniforms = uniforms;
+    translucent_uniforms[2] = translucent_table;
+    translucent_id = vulkan->attachShader(world->vert_shader, world->frag_shader, sizeof(ChunkMesh::Vertex),
+                                          vert_formats, translucent_uniforms, world->textures, subpass, cull_mode,
+                                          false);
+}
+
+void RegionMesh::attach_shadow(vk::ShaderModule vert_shader, vk::ShaderModule frag_shader, uint32_t subpass) {
+    // the faces away from the sun go into the map, the lit ones are then never behind their own depth
+    std::map<int, Vulkan::Buffer> shadow_uniforms = {{2, uniforms[2]}, {5, uniforms[5]}};
+    shadow_id = vulkan->attachShader(vert_shader, frag_shader, sizeof(ChunkMesh::Vertex), vert_formats,
+                                     shadow_uniforms, {}, subpass, vk::CullModeFlagBits::eFront, false, false);
+}
+
+void RegionMesh::rebuild() {
+    ChunkTable table = {}, translucent_chunks = {};
+    table.chunk_count = translucent_chunks.chunk_count = (int)chunks.size();
+
+    std::vector<ChunkMesh::Vertex> mesh;
+    translucent_mesh.clear();
+    first_vertex.resize(chunks.size() + 1);
+    translucent_first_vertex.resize(chunks.size() + 1);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        auto origin = glm::ivec3(chunks[i]->position) * CHUNK_SIZE;
+        auto& chunk_mesh = chunks[i]->mesh;
+
+        first_vertex[i] = (uint32_t)mesh.size();
+        table.chunks[i] = glm::ivec4(origin, first_vertex[i]);
+        mesh.insert(mesh.end(), chunk_mesh.opaque.begin(), chunk_mesh.opaque.end());
+
+        translucent_first_vertex[i] = (uint32_t)translucent_mesh.size();
+        translucent_chunks.chunks[i] = glm::ivec4(origin, translucent_first_vertex[i]);
+        translucent_mesh.insert(translucent_mesh.end(), chunk_mesh.translucent.begin(), chunk_mesh.translucent.end());
+    }
+    first_vertex.back() = (uint32_t)mesh.size();
+    translucent_first_vertex.back() = (uint32_t)translucent_mesh.size();
+
+    if (mesh.empty()) {
+        vulkan->destroyVertexBuffer(vertex);
+        vertex = {};
+    } else
+        write_vertex(mesh);
+    write_uniform(2, table);
+
+    // filled by draw_translucent()
+    if (translucent.size != translucent_mesh.size() * sizeof(ChunkMesh::Vertex)) {
+        vulkan->destroyDynamicVertexBuffer(translucent);
+        translucent = {};
+        if (!translucent_mesh.empty())
+            translucent = vulkan->createDynamicVertexBuffer(sizeof(ChunkMesh::Vertex), translucent_mesh.size());
+    }
+    vulkan->writeUniform(translucent_table, &translucent_chunks);
+
+    dirty = false;
+}
+
+template <typename Visible>
+uint32_t RegionMesh::draw_visible(uint32_t id, uint32_t instance, Visible is_visible, uint32_t& vertices) {
+    // neighbor visible chunks are neighbors in the buffer too, so a fully visible region is a single draw
+    bool bound = false;
+    uint32_t first = 0, count = 0, calls = 0;
+    auto flush = [&]() {
+        if (!count) return;
+        if (!bound) vulkan->bind(id, vertex);
+        bound = true;
+        vulkan->drawVertices(first, count, instance);
+        ++calls;
+        vertices += count;
+        count = 0;
+    };
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        uint32_t size = first_vertex[i + 1] - first_vertex[i];
+        if (!size) continue;
+
+        if (is_visible(*chunks[i])) {
+            if (!count) first = first_vertex[i];
+            count += size;
+        } else
+            flush();
+    }
+    flush();
+    return calls;
+}
+
+void RegionMesh::draw() {
+    draw_calls = vertices = 0;
+    if (draw_id == -1 || !vertex.size || !near) return;
+
+    draw_calls =
+        draw_visible(draw_id, 0, [&](const ChunkMesh& chunk) { return chunk.is_on_frustum(world->camera); }, vertices);
+}
+
+void RegionMesh::draw_shadow(int cascade) {
+    draw_calls = vertices = 0;
+    if (shadow_id == -1 || !vertex.size || !near) return;
+
+    auto& cascades = world->shadows->cascades;
+    draw_calls = draw_visible(
+        shadow_id, cascade,
+        [&](const ChunkMesh& chunk) { return cascades.is_on_cascade(cascade, chunk.center, CHUNK_SPHERE_RADIUS); },
+        vertices);
+}
+
+void RegionMesh::draw_translucent() {
+    draw_calls = vertices = 0;
+    if (translucent_id == -1 || !translucent.size || !near) return;
+    auto& camera = world->camera;
+
+    // visible chunks back to front
+    sorted_chunks.clear();
+    for (size_t i = 0; i < chunks.size(); ++i)
+        if (translucent_first_vertex[i + 1] > translucent_first_vertex[i] && chunks[i]->is_on_frustum(camera))
+            sorted_chunks.emplace_back(-glm::distance(chunks[i]->center, camera.position), (int)i);
+    if (sorted_chunks.empty()) return;
+    std::sort(sorted_chunks.begin(), sorted_chunks.end());
+
+    // key the quads by chunk rank, then by their own distance, both back to front
+    sorted_quads.clear();
+    for (size_t rank = 0; rank < sorted_chunks.size(); ++rank) {
+        int i = sorted_chunks[rank].second;
+        auto origin = chunks[i]->position * (float)CHUNK_SIZE;
+
+        for (uint32_t first = translucent_first_vertex[i]; first < translucent_first_vertex[i + 1]; first += 6) {
+            auto lo = Chunk<CHUNK_SIZE>::unpack_position(translucent_mesh[first]), hi = lo;
+            for (uint32_t v = first + 1; v < first + 6; ++v) {
+                auto position = Chunk<CHUNK_SIZE>::unpack_position(translucent_mesh[v]);
+                lo = glm::min(lo, position);
+                hi = glm::max(hi, position);
+            }
+
+            float dist = glm::distance(origin + glm::vec3(lo + hi) * 0.5f, camera.position);
+            uint64_t depth = 0xffff - (uint64_t)std::min(dist / ZFAR * 0xffff, (float)0xffff);
+            sorted_quads.push_back((rank << 16 | depth) << 32 | first);
+        }
+    }
+    radix_sort(sorted_quads, sort_scratch);
+
+    // chunks keep their ranges, only the quads inside are reordered
+    auto offset = vulkan->frameOffset(translucent);
+    auto data = (ChunkMesh::Vertex*)((char*)translucent.data + offset);
+    uint32_t out = 0;
+    size_t rank = -1;
+    for (auto quad : sorted_quads) {
+        if ((quad >> 48) != rank) {
+            rank = quad >> 48;
+            out = translucent_first_vertex[sorted_chunks[rank].second];
+        }
+        memcpy(data + out, &translucent_mesh[(uint32_t)quad], 6 * sizeof(ChunkMesh::Vertex));
+        out += 6;
+    }
+
+    vulkan->bind(translucent_id, translucent, offset);
+    for (auto& sorted_chunk : sorted_chunks) {
+        auto first = translucent_first_vertex[sorted_chunk.second];
+        vulkan->drawVertices(first, translucent_first_vertex[sorted_chunk.second + 1] - first);
+        ++draw_calls;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "chunk_mesh.h"
+#include "shader.h"
+
+// A region packs the meshes of REGION_SIZE x REGION_SIZE chunk columns into one vertex buffer.
+// It is drawn with a single call when all of its chunks are visible, and falls back to
+// per chunk ranges only when it crosses the frustum edges.
+// Translucent quads live in a second buffer, resorted back to front every frame.
+// The opaque buffer is drawn again into the shadow cascades, with a depth only pipeline.
+struct RegionMesh : Shader {
+    RegionMesh(Engine& engine, World* world);
+    virtual ~RegionMesh() override;
+
+    virtual void init() override;
+    virtual void attach(uint32_t subpass = 0) override;
+    virtual void draw() override;
+    void draw_translucent();
+    void attach_shadow(vk::ShaderModule vert_shader, vk::ShaderModule frag_shader, uint32_t subpass);
+    void draw_shadow(int cascade);
+
+    void rebuild();
+    // starts meshing its chunks when it comes near, and frees them when it goes far
+    void set_meshed(bool meshed);
+    // meshes up to budget of its chunks, it is drawn once all of them are; returns what is left of the budget
+    int mesh_chunks(int budget);
+
+    // mirrors the region_t block of chunk.vert
+    struct ChunkTable {
+        std::array<glm::ivec4, MAX_REGION_CHUNKS> chunks;  // xyz: chunk origin, w: first vertex
+        int chunk_count;
+    };
+
+    void build_dag();
+    void set_voxel(glm::ivec3 world_pos, uint8_t voxel_id);
+
+    World* world;
+    std::vector<ChunkMesh*> chunks;
+    glm::vec3 center;
+    glm::ivec3 origin;  // of the far field DAG, in voxels
+    VoxelDag dag;
+
+    // one more than chunks, the last one is the vertex count
+    std::vector<uint32_t> first_vertex;
+    std::vector<uint32_t> translucent_first_vertex;
+
+    std::vector<ChunkMesh::Vertex> translucent_mesh;
+    Vulkan::Buffer translucent;
+    Vulkan::Buffer translucent_table;
+    uint32_t translucent_id = -1;
+    uint32_t shadow_id = -1;
+    bool dirty = true;
+    bool near = true;       // drawn, all of its chunks are meshed; the far field draws the others
+    bool meshed = false;    // its chunks are meshed or being meshed
+    size_t next_chunk = 0;  // the first chunk still to mesh, while meshed but not near yet
+
+    // of its last draw, the regions are recorded in parallel and summed after
+    uint32_t draw_calls = 0;
+    uint32_t vertices = 0;
+
+   private:
+    // the visible ranges of the opaque buffer, returns the draw count
+    template <typename Visible>
+    uint32_t draw_visible(uint32_t id, uint32_t instance, Visible is_visible, uint32_t& vertices);
+
+    std::vector<std::pair<float, int>> sorted_chunks;
+    std::vector<uint64_t> sorted_quads, sort_scratch;
+};
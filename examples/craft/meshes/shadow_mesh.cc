@@ -0,0 +1,64 @@
+#include "shadow_mesh.h"
+
+#include <chrono>
+
+#include "world.h"
+
+ShadowMesh::ShadowMesh(Engine& engine, World& world)
+    : Shader("chunk_shadow", engine), engine(engine), world(world), cascades(engine.get_player(), ZNEAR) {}
+
+void ShadowMesh::init() {
+    // no need to call Shader::init(), the cascades are written to the shadow_t block of world
+}
+
+void ShadowMesh::update() {
+    float azimuth = SUN_AZIMUTH + SUN_SPEED * engine.get_time();
+    auto sun = glm::vec3(std::cos(SUN_ELEVATION) * std::cos(azimuth), std::sin(SUN_ELEVATION),
+                         std::cos(SUN_ELEVATION) * std::sin(azimuth));
+    cascades.update(sun);
+
+    // the cascades that are not redrawn keep the matrix they were drawn with
+    for (int i = 0; i < SHADOW_CASCADES; ++i) {
+        auto& cascade = cascades.cascades[i];
+        layout.light_vp[i] = cascade.view_proj();
+        layout.cascades[i] = glm::vec4(cascade.split, cascade.texel_size(), 0, 0);
+    }
+    layout.sun_dir = glm::vec4(sun, 0);
+    world.write_uniform(5, layout);
+}
+
+void ShadowMesh::attach(uint32_t subpass) {
+    // one depth only pass per cascade, the near one first
+    for (auto& map : maps) {
+        auto builder = Vulkan::makeRenderPassBuilder(vk::Format::eD16Unorm, false, false, true);
+        builder.extent = vk::Extent2D(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+        vulkan->addRenderPass(builder);
+        map = engine.get_offscreen_depth_texture();
+    }
+
+    // the passes are compatible, so the pipelines work in all of them
+    for (auto& region : world.regions) region->attach_shadow(vert_shader, frag_shader, subpass);
+
+    vulkan->destroyShaderModule(frag_shader);
+    vulkan->destroyShaderModule(vert_shader);
+}
+
+void ShadowMesh::draw() {
+    // renderBegin() has begun the pass of the near cascade, it is redrawn every frame
+    for (int i = 0; i < SHADOW_CASCADES; ++i) {
+        auto& cascade = cascades.cascades[i];
+        if (i) vulkan->nextPass(!cascade.redraw);
+        if (!cascade.redraw) continue;
+
+        auto start = std::chrono::steady_clock::now();
+        cascade.draw_calls = cascade.vertices = 0;
+        vulkan->recordParallel((int)world.regions.size(), [&](int r) { world.regions[r]->draw_shadow(i); });
+        for (auto& region : world.regions) {
+            cascade.draw_calls += region->draw_calls;
+            cascade.vertices += region->vertices;
+        }
+        cascade.record_time =
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    vulkan->nextPass();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "settings.h"
+#include "shader.h"
+#include "shadow_cascades.h"
+
+struct World;
+
+// Sun shadows: every cascade is a depth only render pass of its own, ahead of the main one.
+// The regions draw their opaque buffers into it with chunk_shadow.vert, culled against the cascade box,
+// and chunk.frag picks the cascade from the view depth. A cascade that is not redrawn skips its pass,
+// its map keeps what was drawn the last time.
+struct ShadowMesh : Shader {
+    ShadowMesh(Engine& engine, World& world);
+
+    virtual void init() override;
+    virtual void update() override;
+    virtual void attach(uint32_t subpass = 0) override;
+    virtual void draw() override;
+
+    // mirrors the shadow_t block of chunk_shadow.glsl
+    struct Layout {
+        std::array<glm::mat4, SHADOW_CASCADES> light_vp;
+        std::array<glm::vec4, SHADOW_CASCADES> cascades;  // x: far end in view depth, y: texel size in blocks
+        glm::vec4 sun_dir;
+    };
+
+    Engine& engine;
+    World& world;
+    ShadowCascades cascades;
+    Layout layout = {};
+    std::array<Vulkan::Texture, SHADOW_CASCADES> maps;  // owned by their render passes
+};
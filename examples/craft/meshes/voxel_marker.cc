@@ -44,8 +44,7 @@ void VoxelMarkerMesh::init() {
     for (auto& vertex : vertex_data) vertex.pos = (vertex.pos - 0.5f) * 1.01f + 0.5f;
     write_vertex(vertex_data);
 
-    write_uniform(2, glm::mat4(1));
-    write_uniform(3, interaction_mode);
+    write_push_constant(PushConstants{glm::mat4(1), interaction_mode});
     write_texture(4, "frame.png");
 }
 
@@ -58,8 +57,7 @@ void VoxelMarkerMesh::update() {
         else
             position = voxel_world_pos;
     }
-    write_uniform(2, glm::translate(glm::mat4(1), position));
-    write_uniform(3, interaction_mode);
+    write_push_constant(PushConstants{glm::translate(glm::mat4(1), position), interaction_mode});
 }
 
 void VoxelMarkerMesh::draw() {
@@ -73,20 +71,16 @@ void VoxelMarkerMesh::add_voxel() {
     auto result = get_voxel_info(voxel_world_pos + voxel_normal);
     if (!result.chunk) return;
 
-    // is the new place empty?
-    if (!result.id) {
+    // is the new place empty? water gives way
+    if (!result.id || Chunk<CHUNK_SIZE>::is_water(result.id)) {
         auto chunk = result.chunk;
-        chunk->voxels->at(result.index) = new_voxel_id;
+        chunk->get_voxels().at(result.index) = new_voxel_id;
+        chunk->region->set_voxel(voxel_world_pos + voxel_normal, new_voxel_id);
+        world.fluid->set_voxel(voxel_world_pos + voxel_normal, new_voxel_id);
         rebuild_adj_chunks();
 
-        // was it an empty chunk?
-        if (!chunk->empty) [[likely]]
-            chunk->rebuild_mesh();
-        else {
-            chunk->empty = false;
-            chunk->init();
-            chunk->attach();
-        }
+        chunk->empty = false;
+        chunk->rebuild_mesh();
     }
 }
 
@@ -118,12 +112,15 @@ void VoxelMarkerMesh::rebuild_adj_chunks() {
 void VoxelMarkerMesh::remove_voxel() {
     if (!voxel_id) return;
 
-    chunk->voxels->at(voxel_index) = 0;
+    chunk->get_voxels().at(voxel_index) = 0;
+    chunk->region->set_voxel(voxel_world_pos, 0);
+    world.fluid->set_voxel(voxel_world_pos, 0);
     rebuild_adj_chunks();
     chunk->rebuild_mesh();
 
     // was it an empty chunk?
-    chunk->empty = !std::any_of(chunk->voxels->begin(), chunk->voxels->end(), [](uint8_t id) { return id != 0; });
+    auto& voxels = chunk->get_voxels();
+    chunk->empty = !std::any_of(voxels.begin(), voxels.end(), [](uint8_t id) { return id != 0; });
 }
 
 void VoxelMarkerMesh::set_voxel() {
@@ -135,6 +132,8 @@ void VoxelMarkerMesh::set_voxel() {
 
 void VoxelMarkerMesh::switch_mode() { interaction_mode = !interaction_mode; }
 
+void VoxelMarkerMesh::switch_voxel() { new_voxel_id = new_voxel_id == WATER ? SAND : WATER; }
+
 bool VoxelMarkerMesh::ray_cast() {
     auto ray = camera.forward * (float)MAX_RAY_DIST;
 
@@ -211,6 +210,6 @@ VoxelMarkerMesh::VoxelInfo VoxelMarkerMesh::get_voxel_info(glm::ivec3 voxel_worl
     auto voxel_index = voxel_local_pos.x + CHUNK_SIZE * voxel_local_pos.z + CHUNK_AREA * voxel_local_pos.y;
     if (voxel_index < 0) return {};
 
-    auto voxel_id = chunk->voxels->at(voxel_index);
+    auto voxel_id = chunk->get_voxels().at(voxel_index);
     return {voxel_id, voxel_index, voxel_local_pos, chunk.get()};
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "chunk_mesh.h"
+#include "shader.h"
 
 struct World;
 struct VoxelMarkerMesh : Shader {
@@ -16,6 +17,7 @@ struct VoxelMarkerMesh : Shader {
     void remove_voxel();
     void set_voxel();
     void switch_mode();
+    void switch_voxel();  // between sand and still water
     bool ray_cast();
 
     struct VoxelInfo {
@@ -27,6 +29,12 @@ struct VoxelMarkerMesh : Shader {
 
     VoxelInfo get_voxel_info(glm::ivec3 voxel_world_pos);
 
+    // mirrors push_t of voxel_marker.vert
+    struct PushConstants {
+        glm::mat4 model;
+        uint32_t mode_id;
+    };
+
     struct Vertex {
         Vertex(float x, float y, float z, float u, float v) : pos(x, y, z), uv(u, v) {}
         glm::vec3 pos;
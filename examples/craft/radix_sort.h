@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+// Stable LSD radix sort of items by their high 32 bits, the low 32 bits are the payload.
+// Passes where all the items share the same byte are skipped.
+inline void radix_sort(std::vector<uint64_t>& items, std::vector<uint64_t>& scratch) {
+    if (items.empty()) return;
+    scratch.resize(items.size());
+
+    for (int shift = 32; shift < 64; shift += 8) {
+        std::array<size_t, 256> offsets = {};
+        for (auto item : items) ++offsets[item >> shift & 0xff];
+        if (offsets[items.front() >> shift & 0xff] == items.size()) continue;
+
+        size_t sum = 0;
+        for (auto& offset : offsets) sum += std::exchange(offset, sum);
+
+        for (auto item : items) scratch[offsets[item >> shift & 0xff]++] = item;
+        items.swap(scratch);
+    }
+}
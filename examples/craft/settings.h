@@ -25,6 +25,26 @@ constexpr int WORLD_D = WORLD_W;
 constexpr int WORLD_AREA = WORLD_W * WORLD_D;
 constexpr int WORLD_VOL = WORLD_AREA * WORLD_H;
 
+// region (chunk columns batched into one vertex buffer)
+constexpr int REGION_SIZE = 4;
+constexpr int REGION_VOL = REGION_SIZE * REGION_SIZE * WORLD_H;
+constexpr int MAX_REGION_CHUNKS = 64;  // must match chunk.vert
+static_assert(REGION_VOL <= MAX_REGION_CHUNKS);
+
+// far field, regions past the mesh radius are ray marched through a coarse occupancy grid instead
+constexpr bool FAR_FIELD = true;
+constexpr float FAR_FIELD_RADIUS = 2 * REGION_SIZE * CHUNK_SIZE;      // in blocks, closer regions are meshed
+constexpr float FAR_FIELD_HYSTERESIS = REGION_SIZE * CHUNK_SIZE / 2;  // in blocks, past the radius before unmeshed
+constexpr int NEAR_MESH_BUDGET = 4;                                   // chunks meshed per frame as regions come near
+constexpr int FAR_CELL_SIZE = 4;                                      // in blocks
+constexpr int MAX_REGIONS = 512;                                      // must match far_field.frag
+static_assert(REGION_SIZE * CHUNK_SIZE % FAR_CELL_SIZE == 0);
+static_assert(((WORLD_W + REGION_SIZE - 1) / REGION_SIZE) * ((WORLD_D + REGION_SIZE - 1) / REGION_SIZE) <= MAX_REGIONS);
+
+// voxel storage, chunks over budget or unused for a while are compressed
+constexpr size_t VOXEL_BUDGET = 32 << 20;
+constexpr float COLD_CHUNK_SECONDS = 10;
+
 // world center
 constexpr int CENTER_XZ = WORLD_W * H_CHUNK_SIZE;
 constexpr int CENTER_Y = WORLD_H * H_CHUNK_SIZE;
@@ -40,6 +60,20 @@ constexpr float ZFAR = 2000.0f;
 constexpr glm::vec3 PLAYER_POS = glm::vec3(CENTER_XZ, WORLD_H* CHUNK_SIZE, CENTER_XZ);
 constexpr float MOUSE_SENSITIVITY = 0.002f;
 
+// sun, the azimuth turns at SUN_SPEED radians per second
+constexpr float SUN_ELEVATION = glm::radians(50.0f);
+constexpr float SUN_AZIMUTH = glm::radians(30.0f);
+constexpr float SUN_SPEED = 0.0f;
+
+// sun shadows, the view distance is split between the cascades, cascade i is redrawn every 2^i frames
+constexpr int SHADOW_CASCADES = 4;  // must match chunk_shadow.glsl and the maps of chunk.frag
+constexpr uint32_t SHADOW_MAP_SIZE = 2048;
+constexpr float SHADOW_DISTANCE = 2 * REGION_SIZE * CHUNK_SIZE;  // in blocks along the view
+constexpr float SHADOW_SPLIT_LAMBDA = 0.75f;                      // 0 for uniform splits, 1 for logarithmic ones
+constexpr float SHADOW_CASTER_DISTANCE = WORLD_H * CHUNK_SIZE;    // casters this far towards the sun are kept
+constexpr float SHADOW_MARGIN = 0.1f;  // of the radius, the slack a cascade gets before it has to be redrawn
+constexpr float SHADOW_SUN_EPSILON = glm::radians(0.5f);  // sun motion a far cascade lags behind
+
 // colors
 constexpr glm::vec3 BG_COLOR = glm::vec3(0.58, 0.83, 0.99);
 
@@ -51,6 +85,8 @@ constexpr int STONE = 4;
 constexpr int SNOW = 5;
 constexpr int LEAVES = 6;
 constexpr int WOOD = 7;
+constexpr int WATER = 8;  // still water, WATER + level for the flowing levels
+constexpr int WATER_LEVELS = 8;
 
 // terrain levels
 constexpr int SNOW_LVL = 54;
@@ -66,7 +102,13 @@ constexpr int TREE_H_WIDTH = TREE_WIDTH / 2, TREE_H_HEIGHT = TREE_HEIGHT / 2;
 
 // water
 constexpr int WATER_AREA = 5 * CHUNK_SIZE * WORLD_W;
+constexpr float FLUID_TICK_SECONDS = 0.2f;
+constexpr size_t FLUID_TICK_BUDGET = 4096;  // cells per tick, the others wait for the next one
 
 // cloud
 constexpr int CLOUD_SCALE = 25;
 constexpr int CLOUD_HEIGHT = WORLD_H * CHUNK_SIZE * 2;
+constexpr int CLOUD_STRIPS = 8;               // of the parallel merge, quads are split at the strip borders
+constexpr bool CLOUD_PARALLEL_MERGE = false;  // the same quads as the single greedy merge without it
+constexpr int CLOUD_THICKNESS = 8;
+constexpr bool PROCEDURAL_CLOUDS = true;  // ray marched in a slab instead of meshed
@@ -0,0 +1,75 @@
+#include "shadow_cascades.h"
+
+#include <cmath>
+
+ShadowCascades::ShadowCascades(const Camera& camera, float znear) : camera(camera) {
+    // the corners of a slice are k times their view depth off the view axis
+    float k2 = camera.frustum.tan_x * camera.frustum.tan_x + camera.frustum.tan_y * camera.frustum.tan_y;
+
+    float near = znear;
+    for (int i = 0; i < SHADOW_CASCADES; ++i) {
+        float t = (i + 1) / (float)SHADOW_CASCADES;
+        float uniform = znear + (SHADOW_DISTANCE - znear) * t;
+        float logarithmic = znear * std::pow(SHADOW_DISTANCE / znear, t);
+        float far = glm::mix(uniform, logarithmic, SHADOW_SPLIT_LAMBDA);
+        cascades[i].split = far;
+
+        // as far from the near corners as from the far ones, unless that is past the far end
+        float center = std::min((near + far) * (1 + k2) / 2, far);
+        slice_centers[i] = center;
+        slice_radii[i] = std::sqrt((far - center) * (far - center) + far * far * k2);
+        near = far;
+    }
+}
+
+void ShadowCascades::update(glm::vec3 sun) {
+    for (int i = 0; i < SHADOW_CASCADES; ++i) {
+        auto& cascade = cascades[i];
+        auto center = camera.position + camera.forward * slice_centers[i];
+        float radius = slice_radii[i];
+
+        ++cascade.age;
+        bool inside = glm::distance(center, cascade.center) + radius <= cascade.radius;
+        bool sun_moved = glm::dot(sun, cascade.sun) < std::cos(SHADOW_SUN_EPSILON);
+        cascade.redraw = !cascade.drawn || cascade.age >= (1 << i) || !inside || sun_moved;
+        if (!cascade.redraw) continue;
+
+        // the near cascade is redrawn every frame, it needs no slack
+        fit(cascade, center, i ? radius * (1 + SHADOW_MARGIN) : radius, sun);
+        cascade.age = 0;
+        cascade.drawn = true;
+    }
+}
+
+bool ShadowCascades::is_on_cascade(int i, glm::vec3 center, float radius) const {
+    auto& cascade = cascades[i];
+    auto light_pos = glm::vec3(cascade.view * glm::vec4(center, 1));
+
+    // the box starts at the light, which is already SHADOW_CASTER_DISTANCE past the slice
+    float extent = cascade.radius + radius;
+    float depth = 2 * cascade.radius + SHADOW_CASTER_DISTANCE;
+    return std::abs(light_pos.x) <= extent && std::abs(light_pos.y) <= extent && light_pos.z <= radius &&
+           light_pos.z >= -depth - radius;
+}
+
+void ShadowCascades::fit(Cascade& cascade, glm::vec3 center, float radius, glm::vec3 sun) {
+    auto up = std::abs(sun.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+    auto rotation = glm::lookAt(glm::vec3(0), -sun, up);
+
+    // move the box by whole texels across the light
+    float texel = 2 * radius / SHADOW_MAP_SIZE;
+    auto light_center = glm::vec3(rotation * glm::vec4(center, 1));
+    light_center.x = std::round(light_center.x / texel) * texel;
+    light_center.y = std::round(light_center.y / texel) * texel;
+    center = glm::vec3(glm::inverse(rotation) * glm::vec4(light_center, 1));
+
+    float distance = radius + SHADOW_CASTER_DISTANCE;
+    cascade.view = glm::lookAt(center + sun * distance, center, up);
+    cascade.proj = glm::ortho(-radius, radius, -radius, radius, 0.0f, distance + radius);
+    // flipped like the camera, so the faces keep their winding
+    cascade.proj[1][1] *= -1;
+
+    cascade.center = center;
+    cascade.radius = radius;
+    cascade.sun = sun;
+}
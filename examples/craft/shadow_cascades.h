@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+
+#include "camera.h"
+#include "settings.h"
+
+// Cascaded shadow maps for the sun. The view up to SHADOW_DISTANCE is split into slices, each cascade
+// fits an orthographic box around the bounding sphere of its slice, so the box does not change size when
+// the camera turns, and moves it by whole texels, so the shadow edges do not shimmer when it moves.
+// Cascade i is redrawn every 2^i frames, when its slice leaves the box it was drawn with or when the sun
+// has moved; in between it is sampled with the matrix it was drawn with.
+struct ShadowCascades {
+    struct Cascade {
+        glm::mat4 view = glm::mat4(1);
+        glm::mat4 proj = glm::mat4(1);
+        glm::vec3 center{0};  // of the box
+        float radius = 0;     // half the box size, in blocks
+        glm::vec3 sun{0};     // drawn with
+        float split = 0;      // far end of the slice, in view depth
+        int age = 0;          // frames since drawn
+        bool drawn = false;
+        bool redraw = false;  // in this frame
+
+        // of the last time it was drawn
+        uint32_t draw_calls = 0;
+        uint32_t vertices = 0;
+        float record_time = 0;  // in milliseconds
+
+        glm::mat4 view_proj() const { return proj * view; }
+        float texel_size() const { return 2 * radius / SHADOW_MAP_SIZE; }
+    };
+
+    ShadowCascades(const Camera& camera, float znear);
+
+    // picks the cascades redrawn in this frame and fits them to the view
+    void update(glm::vec3 sun);
+
+    // a sphere touching the box of a cascade, or between it and the sun
+    bool is_on_cascade(int i, glm::vec3 center, float radius) const;
+
+    const Camera& camera;
+    std::array<Cascade, SHADOW_CASCADES> cascades;
+
+   private:
+    void fit(Cascade& cascade, glm::vec3 center, float radius, glm::vec3 sun);
+
+    // of the slices, along the view axis
+    std::array<float, SHADOW_CASCADES> slice_centers;
+    std::array<float, SHADOW_CASCADES> slice_radii;
+};
@@ -0,0 +1,143 @@
+#include "voxel_dag.h"
+
+#include <algorithm>
+#include <limits>
+
+size_t VoxelDag::NodeHash::operator()(const Node& node) const {
+    // FNV-1a
+    size_t hash = 14695981039346656037ull;
+    for (auto child : node) hash = (hash ^ child) * 1099511628211ull;
+    return hash;
+}
+
+uint32_t VoxelDag::intern(const Node& node) {
+    // a node of one uniform value is that value
+    if (node[0] & UNIFORM && std::all_of(node.begin(), node.end(), [&](uint32_t child) { return child == node[0]; }))
+        return node[0];
+
+    auto [it, inserted] = lookup.try_emplace(node, (uint32_t)nodes.size());
+    if (inserted) nodes.push_back(node);
+    return it->second;
+}
+
+uint8_t VoxelDag::get(glm::ivec3 pos) const {
+    uint32_t ref = root;
+    for (int level = levels - 1; !(ref & UNIFORM); --level)
+        ref = nodes[ref][(pos.x >> level & 1) | (pos.y >> level & 1) << 1 | (pos.z >> level & 1) << 2];
+    return (uint8_t)ref;
+}
+
+void VoxelDag::set(glm::ivec3 pos, uint8_t voxel_id) {
+    root = set(root, levels, pos, voxel_id);
+
+    // every edit leaves at most levels nodes behind
+    if (nodes.size() > 2 * live_nodes + 1024) compact();
+}
+
+uint32_t VoxelDag::set(uint32_t ref, int level, glm::ivec3 pos, uint8_t voxel_id) {
+    if (!level) return UNIFORM | voxel_id;
+
+    Node node;
+    if (ref & UNIFORM)
+        node.fill(ref);
+    else
+        node = nodes[ref];
+
+    --level;
+    auto& child = node[(pos.x >> level & 1) | (pos.y >> level & 1) << 1 | (pos.z >> level & 1) << 2];
+    child = set(child, level, pos, voxel_id);
+    return intern(node);
+}
+
+void VoxelDag::compact() {
+    std::vector<Node> to;
+    std::unordered_map<Node, uint32_t, NodeHash> to_lookup;
+    std::unordered_map<uint32_t, uint32_t> copied;
+
+    root = copy(root, to, to_lookup, copied);
+    nodes.swap(to);
+    lookup.swap(to_lookup);
+    live_nodes = nodes.size();
+}
+
+uint32_t VoxelDag::copy(uint32_t ref, std::vector<Node>& to, std::unordered_map<Node, uint32_t, NodeHash>& to_lookup,
+                        std::unordered_map<uint32_t, uint32_t>& copied) const {
+    if (ref & UNIFORM) return ref;
+    if (auto it = copied.find(ref); it != copied.end()) return it->second;
+
+    Node node;
+    for (int i = 0; i < 8; ++i) node[i] = copy(nodes[ref][i], to, to_lookup, copied);
+
+    auto [it, inserted] = to_lookup.try_emplace(node, (uint32_t)to.size());
+    if (inserted) to.push_back(node);
+    return copied[ref] = it->second;
+}
+
+VoxelDag::Hit VoxelDag::raycast(glm::vec3 origin, glm::vec3 dir, float max_t) const {
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    // t where the ray crosses the lo and hi planes of a block along an axis
+    auto cross = [&](int axis, float lo, float hi) {
+        if (dir[axis] == 0) {
+            bool inside = origin[axis] >= lo && origin[axis] < hi;
+            return inside ? glm::vec2(-inf, inf) : glm::vec2(inf, -inf);
+        }
+        float t0 = (lo - origin[axis]) / dir[axis], t1 = (hi - origin[axis]) / dir[axis];
+        return dir[axis] > 0 ? glm::vec2(t0, t1) : glm::vec2(t1, t0);
+    };
+
+    // clip to the cube
+    float t = 0;
+    glm::ivec3 normal(0);
+    int step_axis = -1, step_cell = 0;  // the cell entered along the last crossed axis
+    for (int axis = 0; axis < 3; ++axis) {
+        auto range = cross(axis, 0, (float)size());
+        if (range.x > t) {
+            t = range.x;
+            step_axis = axis;
+            step_cell = dir[axis] > 0 ? 0 : size() - 1;
+        }
+        max_t = std::min(max_t, range.y);
+    }
+
+    // the ray is monotonic along every axis, so rounding is never allowed to step back over a crossed border
+    glm::ivec3 pos(-1);
+    for (bool first = true; t < max_t; first = false) {
+        for (int axis = 0; axis < 3; ++axis) {
+            int cell = std::clamp((int)std::floor(origin[axis] + t * dir[axis]), 0, size() - 1);
+            if (axis == step_axis)
+                cell = step_cell;
+            else if (!first)
+                cell = dir[axis] > 0 ? std::max(cell, pos[axis]) : std::min(cell, pos[axis]);
+            pos[axis] = cell;
+        }
+
+        // the largest uniform block around pos
+        uint32_t ref = root;
+        int level = levels;
+        while (!(ref & UNIFORM)) {
+            --level;
+            ref = nodes[ref][(pos.x >> level & 1) | (pos.y >> level & 1) << 1 | (pos.z >> level & 1) << 2];
+        }
+        if (ref != UNIFORM) {
+            if (step_axis != -1) normal[step_axis] = dir[step_axis] > 0 ? -1 : 1;
+            return {(uint8_t)ref, pos, normal, t};
+        }
+
+        // leave the block through the nearest exit plane
+        float exit = inf;
+        for (int axis = 0; axis < 3; ++axis) {
+            int lo = pos[axis] >> level << level;
+            float axis_exit = cross(axis, (float)lo, (float)(lo + (1 << level))).y;
+            if (axis_exit < exit) {
+                exit = axis_exit;
+                step_axis = axis;
+                step_cell = dir[axis] > 0 ? lo + (1 << level) : lo - 1;
+            }
+        }
+        if (step_cell < 0 || step_cell >= size()) break;
+        t = exit;
+    }
+
+    return {0, glm::ivec3(0), glm::ivec3(0), max_t};
+}
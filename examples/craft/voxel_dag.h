@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Sparse voxel DAG over a cube of 2^levels voxels.
+// Uniform blocks collapse into a single child value and identical nodes are shared,
+// edits copy the path to the root and share everything else.
+struct VoxelDag {
+    // a child is either a node index or, with this bit set, a uniform block of the voxel id in the low bits
+    static constexpr uint32_t UNIFORM = 0x80000000;
+    using Node = std::array<uint32_t, 8>;
+
+    VoxelDag(int levels = 0) : levels(levels), root(UNIFORM) {}
+
+    // get_voxel(x, y, z) for every voxel of the cube, blocks where is_empty(x, y, z, size) holds are skipped
+    template <typename GetVoxel, typename IsEmpty>
+    void build(GetVoxel get_voxel, IsEmpty is_empty) {
+        nodes.clear();
+        lookup.clear();
+        root = build(get_voxel, is_empty, glm::ivec3(0), levels);
+        live_nodes = nodes.size();
+    }
+
+    uint8_t get(glm::ivec3 pos) const;
+    void set(glm::ivec3 pos, uint8_t voxel_id);
+
+    struct Hit {
+        uint8_t voxel_id;  // 0 if nothing was hit
+        glm::ivec3 pos;
+        glm::ivec3 normal;
+        float t;
+    };
+    // skips whole uniform empty blocks, origin and max_t are in voxels
+    Hit raycast(glm::vec3 origin, glm::vec3 dir, float max_t) const;
+
+    // drops the nodes left behind by edits
+    void compact();
+
+    int size() const { return 1 << levels; }
+    size_t memory_bytes() const { return nodes.size() * sizeof(Node); }
+
+    int levels;
+    uint32_t root;
+    std::vector<Node> nodes;
+
+   private:
+    struct NodeHash {
+        size_t operator()(const Node& node) const;
+    };
+
+    template <typename GetVoxel, typename IsEmpty>
+    uint32_t build(GetVoxel& get_voxel, IsEmpty& is_empty, glm::ivec3 pos, int level) {
+        if (!level) return UNIFORM | get_voxel(pos.x, pos.y, pos.z);
+        int half = 1 << (level - 1);
+        if (is_empty(pos.x, pos.y, pos.z, 2 * half)) return UNIFORM;
+
+        Node node;
+        for (int i = 0; i < 8; ++i)
+            node[i] = build(get_voxel, is_empty, pos + half * glm::ivec3(i & 1, i >> 1 & 1, i >> 2), level - 1);
+        return intern(node);
+    }
+
+    uint32_t intern(const Node& node);
+    uint32_t set(uint32_t ref, int level, glm::ivec3 pos, uint8_t voxel_id);
+    uint32_t copy(uint32_t ref, std::vector<Node>& to, std::unordered_map<Node, uint32_t, NodeHash>& to_lookup,
+                  std::unordered_map<uint32_t, uint32_t>& copied) const;
+
+    std::unordered_map<Node, uint32_t, NodeHash> lookup;
+    size_t live_nodes = 0;  // after the last build or compact
+};
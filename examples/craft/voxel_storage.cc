@@ -0,0 +1,138 @@
+#include "voxel_storage.h"
+
+#include <algorithm>
+#include <cassert>
+
+VoxelStorage::VoxelStorage(WorldVoxels& voxels, size_t budget, float cold_after)
+    : voxels(voxels),
+      budget(budget),
+      cold_after(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(cold_after))) {
+    auto now = Clock::now();
+    for (int i = 0; i < WORLD_VOL; ++i) {
+        lru_pos[i] = lru.insert(lru.end(), i);
+        last_used[i] = now;
+    }
+
+    worker = std::thread(&VoxelStorage::work, this);
+}
+
+VoxelStorage::~VoxelStorage() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    cv.notify_one();
+    worker.join();
+}
+
+void VoxelStorage::touch(int chunk_index) {
+    if (!voxels[chunk_index]) return;
+
+    lru.splice(lru.begin(), lru, lru_pos[chunk_index]);
+    last_used[chunk_index] = Clock::now();
+}
+
+void VoxelStorage::prefetch(int chunk_index) {
+    if (voxels[chunk_index]) return touch(chunk_index);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (std::find(requests.begin(), requests.end(), chunk_index) != requests.end()) return;
+    requests.push_back(chunk_index);
+    cv.notify_one();
+}
+
+VoxelStorage::Voxels& VoxelStorage::require(int chunk_index) {
+    if (!voxels[chunk_index]) {
+        // only this thread writes compressed, so it can be read without the lock
+        auto data = std::make_unique<Voxels>();
+        decompress(compressed[chunk_index], *data);
+
+        // a prefetch of it may still be on the way, it will be dropped by update()
+        make_resident(chunk_index, std::move(data));
+    }
+
+    touch(chunk_index);
+    return *voxels[chunk_index];
+}
+
+void VoxelStorage::update() {
+    decltype(prefetched) ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(prefetched);
+    }
+    // a chunk required, edited and compressed again since the prefetch has newer voxels than it
+    for (auto& chunk : ready)
+        if (!voxels[chunk.chunk_index] && chunk.generation == generations[chunk.chunk_index])
+            make_resident(chunk.chunk_index, std::move(chunk.data));
+
+    auto now = Clock::now();
+    while (!lru.empty() && (resident_bytes() > budget || now - last_used[lru.back()] > cold_after)) {
+        int chunk_index = lru.back();
+        lru.pop_back();
+
+        auto data = compress(*voxels[chunk_index]);
+        std::lock_guard<std::mutex> lock(mutex);
+        compressed_bytes += data.size();
+        compressed[chunk_index] = std::move(data);
+        ++generations[chunk_index];
+        voxels[chunk_index].reset();
+    }
+}
+
+void VoxelStorage::make_resident(int chunk_index, std::unique_ptr<Voxels> data) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        compressed_bytes -= compressed[chunk_index].size();
+        compressed[chunk_index] = {};
+    }
+
+    voxels[chunk_index] = std::move(data);
+    lru_pos[chunk_index] = lru.insert(lru.begin(), chunk_index);
+    last_used[chunk_index] = Clock::now();
+}
+
+void VoxelStorage::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cv.wait(lock, [this]() { return quit || !requests.empty(); });
+        if (quit) return;
+
+        int chunk_index = requests.front();
+        requests.pop_front();
+
+        // required by the main thread meanwhile
+        if (compressed[chunk_index].empty()) continue;
+
+        auto data = compressed[chunk_index];
+        auto generation = generations[chunk_index];
+        lock.unlock();
+        auto voxels = std::make_unique<Voxels>();
+        decompress(data, *voxels);
+        lock.lock();
+
+        prefetched.push_back({chunk_index, generation, std::move(voxels)});
+    }
+}
+
+std::vector<uint8_t> VoxelStorage::compress(const Voxels& voxels) {
+    // (run length - 1, voxel id) pairs, terrain is mostly made of long horizontal runs
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < voxels.size();) {
+        size_t run = 1;
+        while (run < 256 && i + run < voxels.size() && voxels[i + run] == voxels[i]) ++run;
+
+        data.push_back((uint8_t)(run - 1));
+        data.push_back(voxels[i]);
+        i += run;
+    }
+
+    data.shrink_to_fit();
+    return data;
+}
+
+void VoxelStorage::decompress(const std::vector<uint8_t>& data, Voxels& voxels) {
+    auto out = voxels.begin();
+    for (size_t i = 0; i < data.size(); i += 2) out = std::fill_n(out, data[i] + 1, data[i + 1]);
+    assert(out == voxels.end());
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include "chunk.h"
+
+// Keeps the voxels of recently used chunks resident and run-length encodes the cold ones.
+// A chunk goes cold when it has not been used for `cold_after` seconds, or when it is the
+// least recently used one while the resident chunks are over `budget` bytes.
+// Cold chunks can be prefetched on a worker thread, or decompressed right away when required.
+struct VoxelStorage {
+    using Voxels = Chunk<CHUNK_SIZE>::Voxels;
+    using WorldVoxels = Chunk<CHUNK_SIZE>::WorldVoxels;
+
+    VoxelStorage(WorldVoxels& voxels, size_t budget = VOXEL_BUDGET, float cold_after = COLD_CHUNK_SECONDS);
+    ~VoxelStorage();
+
+    // the chunk is in use, only refreshes chunks that are still resident
+    void touch(int chunk_index);
+    // the chunk will be needed soon, decompressed by the worker if cold
+    void prefetch(int chunk_index);
+    // the chunk is needed now
+    Voxels& require(int chunk_index);
+
+    // installs the prefetched chunks and compresses the cold ones, on the main thread
+    void update();
+
+    size_t resident_bytes() const { return lru.size() * sizeof(Voxels); }
+    size_t compressed_bytes = 0;
+
+    static std::vector<uint8_t> compress(const Voxels& voxels);
+    static void decompress(const std::vector<uint8_t>& data, Voxels& voxels);
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    void make_resident(int chunk_index, std::unique_ptr<Voxels> data);
+    void work();
+
+    WorldVoxels& voxels;
+    size_t budget;
+    Clock::duration cold_after;
+
+    // most recently used first, only resident chunks are in it
+    std::list<int> lru;
+    std::array<std::list<int>::iterator, WORLD_VOL> lru_pos;
+    std::array<Clock::time_point, WORLD_VOL> last_used;
+
+    // shared with the worker
+    std::array<std::vector<uint8_t>, WORLD_VOL> compressed;
+    std::array<uint32_t, WORLD_VOL> generations{};  // of compressed, a prefetch of an older one is stale
+    std::deque<int> requests;
+    struct Prefetched {
+        int chunk_index;
+        uint32_t generation;  // of the compressed data it was decoded from
+        std::unique_ptr<Voxels> data;
+    };
+    std::vector<Prefetched> prefetched;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool quit = false;
+    std::thread worker;
+};
@@ -1,61 +1,188 @@
 #include "world.h"
 
-World::World(Engine& engine) : camera(engine.get_player()), Shader("chunk", engine) {
+#include <algorithm>
+#include <unordered_set>
+
+World::World(Engine& engine)
+    : engine(engine), camera(engine.get_player()), Shader("chunk", engine), gen(voxels), storage(voxels) {
+    gen.generate();
+
+    using C = Chunk<CHUNK_SIZE>;
+    fluid = std::make_unique<FluidSim>(WORLD_W * CHUNK_SIZE, WORLD_H * CHUNK_SIZE, WORLD_D * CHUNK_SIZE);
+    fluid->init(
+        [&](int wx, int wy, int wz) { return (*voxels[C::chunk_index(wx, wy, wz)])[C::voxel_index(wx, wy, wz)]; });
+
 #ifdef _DEBUG
 #pragma omp parallel for
 #endif
     for (int x = 0; x < WORLD_W; ++x)
         for (int y = 0; y < WORLD_H; ++y)
             for (int z = 0; z < WORLD_D; ++z) {
-                auto chunk = std::make_unique<ChunkMesh>(engine, this, glm::vec3(x, y, z));
+                auto chunk = std::make_unique<ChunkMesh>(this, glm::vec3(x, y, z));
                 int chunk_index = x + WORLD_W * z + WORLD_AREA * y;
 
-                voxels[chunk_index] = chunk->build_voxels();
-                chunk->voxels = voxels[chunk_index].get();
+                chunk->index = chunk_index;
+                chunk->empty = !std::any_of(voxels[chunk_index]->begin(), voxels[chunk_index]->end(),
+                                            [](uint8_t id) { return id != 0; });
                 chunks[chunk_index] = std::move(chunk);
             }
+
+    for (int rx = 0; rx < WORLD_W; rx += REGION_SIZE)
+        for (int rz = 0; rz < WORLD_D; rz += REGION_SIZE) {
+            auto region = std::make_unique<RegionMesh>(engine, this);
+
+            // keep the chunks of a column together, they are often visible together
+            for (int x = rx; x < std::min(rx + REGION_SIZE, WORLD_W); ++x)
+                for (int z = rz; z < std::min(rz + REGION_SIZE, WORLD_D); ++z)
+                    for (int y = 0; y < WORLD_H; ++y) {
+                        auto& chunk = chunks[x + WORLD_W * z + WORLD_AREA * y];
+                        chunk->region = region.get();
+                        region->chunks.push_back(chunk.get());
+                    }
+            sorted_regions.push_back(region.get());
+            regions.push_back(std::move(region));
+        }
     voxel_handler = std::make_unique<VoxelMarkerMesh>(engine, *this);
+    if (FAR_FIELD) far_field = std::make_unique<FarFieldMesh>(engine, *this);
+    shadows = std::make_unique<ShadowMesh>(engine, *this);
+}
+
+World::~World() {
+    // erase them to avoid double free
+    for (int i = 0; i < SHADOW_CASCADES; ++i) textures.erase(6 + i);
 }
 
 void World::init() {
     Shader::init();
     write_uniform(3, BG_COLOR, vk::ShaderStageFlagBits::eFragment);
+    // filled by shadows
+    write_uniform(5, ShadowMesh::Layout{}, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
 
-#ifdef _DEBUG
+    // only the near regions are meshed
+    update_near();
+    for (auto& region : regions) region->near = region->meshed;
 #pragma omp parallel for
-#endif
-    for (auto& chunk : chunks)
-        if (!chunk->empty) chunk->init();
+    for (int i = 0; i < WORLD_VOL; ++i)
+        if (!chunks[i]->empty && chunks[i]->region->meshed) chunks[i]->build_mesh();
+    for (auto& region : regions) region->init();
 
+    // before any chunk goes cold
+#pragma omp parallel for
+    for (int i = 0; i < (int)regions.size(); ++i) regions[i]->build_dag();
+
+    // still water and its flowing levels share one texture
     write_texture(4,
                   {"sand.png", "dirt.png", "grass_block_side.png", "grass_block_top.png", "stone.png", "snow.png",
-                   "birch_leaves.png", "birch_log.png", "birch_log_top.png"},
-                  {0, 0, 0, 1, 2, 3, 1, 1, 1, 4, 4, 4, 5, 5, 5, 6, 6, 6, 8, 7, 8});
+                   "birch_leaves.png", "birch_log.png", "birch_log_top.png", "water.png"},
+                  {0, 0, 0, 1, 2, 3, 1, 1, 1, 4, 4, 4, 5, 5, 5, 6, 6, 6, 8, 7, 8, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+                   9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9});
     voxel_handler->init();
+    if (far_field) far_field->init();
+    shadows->init();
 }
 
 void World::update() {
+    Shader::update();
+
+    update_near();
+    // the regions coming near are meshed over several frames, the closest first
+    int budget = NEAR_MESH_BUDGET;
+    for (auto it = sorted_regions.rbegin(); it != sorted_regions.rend() && budget > 0; ++it)
+        if ((*it)->meshed && !(*it)->near) budget = (*it)->mesh_chunks(budget);
+    if (far_field) far_field->update();
+    shadows->update();
+
+    // rendered chunks stay warm, the ones around the player are likely to be edited
     for (auto& chunk : chunks)
-        if (!chunk->empty && chunk->is_on_frustum(camera)) chunk->update();
+        if (!chunk->empty && chunk->region->near && chunk->is_on_frustum(camera)) storage.touch(chunk->index);
+    auto center = glm::ivec3(camera.position) / CHUNK_SIZE;
+    for (int x = center.x - 1; x <= center.x + 1; ++x)
+        for (int y = center.y - 1; y <= center.y + 1; ++y)
+            for (int z = center.z - 1; z <= center.z + 1; ++z) {
+                int chunk_index = Chunk<CHUNK_SIZE>::chunk_index(x * CHUNK_SIZE, y * CHUNK_SIZE, z * CHUNK_SIZE);
+                if (chunk_index != -1) storage.prefetch(chunk_index);
+            }
+    storage.update();
+
+    // flowing water goes through the same path as an edit, each touched chunk is remeshed once
+    using C = Chunk<CHUNK_SIZE>;
+    std::unordered_set<int> remesh;
+    for (auto& change : fluid->update(engine.get_delta_time())) {
+        auto pos = change.pos;
+        int chunk_index = C::chunk_index(pos.x, pos.y, pos.z);
+        auto& voxel = storage.require(chunk_index)[C::voxel_index(pos.x, pos.y, pos.z)];
+        // a block placed since the tick wins
+        if (voxel && !C::is_water(voxel)) continue;
+
+        voxel = change.voxel_id;
+        chunks[chunk_index]->region->set_voxel(pos, change.voxel_id);
+        if (change.voxel_id) chunks[chunk_index]->empty = false;
+
+        // the neighbor chunks share the faces on the border
+        for (auto offset : {glm::ivec3(0), glm::ivec3(1, 0, 0), glm::ivec3(-1, 0, 0), glm::ivec3(0, 1, 0),
+                            glm::ivec3(0, -1, 0), glm::ivec3(0, 0, 1), glm::ivec3(0, 0, -1)}) {
+            auto neighbor = pos + offset;
+            int neighbor_index = C::chunk_index(neighbor.x, neighbor.y, neighbor.z);
+            if (neighbor_index != -1) remesh.insert(neighbor_index);
+        }
+    }
+    for (int chunk_index : remesh) chunks[chunk_index]->rebuild_mesh();
+
+    // not halfway through its meshing
+    for (auto& region : regions)
+        if (region->dirty && region->near == region->meshed) region->rebuild();
     voxel_handler->update();
 }
 
+void World::update_near() {
+    for (auto& region : regions) {
+        auto distance = glm::distance(glm::vec2(region->center.x, region->center.z),
+                                      glm::vec2(camera.position.x, camera.position.z));
+        // a meshed region stays so a little further out, walking along the radius does not remesh it every crossing
+        bool meshed = !far_field || distance < FAR_FIELD_RADIUS + (region->meshed ? FAR_FIELD_HYSTERESIS : 0);
+        if (meshed != region->meshed) region->set_meshed(meshed);
+    }
+}
+
+size_t World::dag_bytes() const {
+    size_t bytes = 0;
+    for (auto& region : regions) bytes += region->dag.memory_bytes();
+    return bytes;
+}
+
 void World::load() {
     Shader::load();
     voxel_handler->load();
+    if (far_field) far_field->load();
+    shadows->load();
 }
 
 void World::attach(uint32_t subpass) {
-    for (auto& chunk : chunks)
-        if (!chunk->empty) chunk->attach(subpass);
+    // the maps of the cascades, their passes are attached by now
+    for (int i = 0; i < SHADOW_CASCADES; ++i) textures[6 + i] = shadows->maps[i];
+
+    for (auto& region : regions) region->attach(subpass);
     voxel_handler->attach(subpass);
+    if (far_field) far_field->attach(subpass);
 
     vulkan->destroyShaderModule(frag_shader);
     vulkan->destroyShaderModule(vert_shader);
 }
 
 void World::draw() {
-    for (auto& chunk : chunks)
-        if (!chunk->empty && chunk->is_on_frustum(camera)) chunk->draw();
+    // the cascades are the first passes of the frame, this ends them
+    shadows->draw();
+
+    draw_calls = 0;
+    vulkan->recordParallel((int)regions.size(), [&](int i) { regions[i]->draw(); });
+    for (auto& region : regions) draw_calls += region->draw_calls;
+    if (far_field) far_field->draw();
+
+    // translucent quads go after all the opaque ones, regions back to front
+    std::sort(sorted_regions.begin(), sorted_regions.end(), [&](RegionMesh* a, RegionMesh* b) {
+        return glm::distance(a->center, camera.position) > glm::distance(b->center, camera.position);
+    });
+    vulkan->recordParallel((int)sorted_regions.size(), [&](int i) { sorted_regions[i]->draw_translucent(); });
+    for (auto region : sorted_regions) draw_calls += region->draw_calls;
     voxel_handler->draw();
 }
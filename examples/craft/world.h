@@ -1,11 +1,18 @@
 #pragma once
 
 #include "engine.h"
+#include "fluid_sim.h"
 #include "meshes/chunk_mesh.h"
+#include "meshes/far_field.h"
+#include "meshes/region_mesh.h"
+#include "meshes/shadow_mesh.h"
 #include "meshes/voxel_marker.h"
+#include "voxel_storage.h"
+#include "world_gen.h"
 
 struct World : Shader {
     World(Engine& engine);
+    virtual ~World() override;
 
     virtual void init() override;
     virtual void update() override;
@@ -13,9 +20,22 @@ struct World : Shader {
     virtual void attach(uint32_t subpass = 0) override;
     virtual void draw() override;
 
+    const Engine& engine;
     const Camera& camera;
     // can we sparse this?
     std::array<std::unique_ptr<ChunkMesh::Voxels>, WORLD_VOL> voxels;
+    WorldGen gen;
+    VoxelStorage storage;
+    std::unique_ptr<FluidSim> fluid;
     std::array<std::unique_ptr<ChunkMesh>, WORLD_VOL> chunks;
+    std::vector<std::unique_ptr<RegionMesh>> regions;
+    std::vector<RegionMesh*> sorted_regions;  // back to front for the translucent pass
+    uint32_t draw_calls = 0;  // chunk draws in the last frame
+
+    size_t dag_bytes() const;
+    // meshes the regions within FAR_FIELD_RADIUS, and leaves the ones past FAR_FIELD_HYSTERESIS more to the far field
+    void update_near();
     std::unique_ptr<VoxelMarkerMesh> voxel_handler;
+    std::unique_ptr<FarFieldMesh> far_field;  // null without FAR_FIELD
+    std::unique_ptr<ShadowMesh> shadows;      // attached ahead of the main pass, see McScene
 };
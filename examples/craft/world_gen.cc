@@ -0,0 +1,232 @@
+#include "world_gen.h"
+
+#include <chrono>
+#include <glm/gtc/noise.hpp>
+#include <stdexcept>
+
+namespace {
+int get_height(glm::vec2 pos) {
+    // amplitude
+    float a1 = CENTER_Y;
+    float a2 = a1 * 0.5f, a4 = a1 * 0.25f, a8 = a1 * 0.125f;
+
+    // frequency
+    float f1 = 0.005f;
+    float f2 = f1 * 2, f4 = f1 * 4, f8 = f1 * 8;
+
+    if (glm::simplex(0.1f * pos) < 0) a1 /= 1.07f;
+
+    float height = 0;
+    height += glm::simplex(f1 * pos) * a1 + a1;
+    height += glm::simplex(f2 * pos) * a2 - a2;
+    height += glm::simplex(f4 * pos) * a4 + a4;
+    height += glm::simplex(f8 * pos) * a8 - a8;
+    height = std::max(height, 1.0f);
+
+    // island mask
+    float island = 1.0f / (std::pow(0.0025f * (std::hypot(pos.x - CENTER_XZ, pos.y - CENTER_XZ)), 20.0f) + 0.0001f);
+    height *= std::min(island, 1.0f);
+
+    return (int)height;
+}
+
+// every (stage, block column) pair gets its own engine, so the result depends neither on the thread schedule
+// nor on the chunk size
+static_assert(WORLD_W * CHUNK_SIZE <= 4096 && WORLD_D * CHUNK_SIZE <= 4096);
+inline std::default_random_engine column_engine(int stage, int wx, int wz) {
+    return std::default_random_engine(SEED + (stage << 24) + (wx << 12) + wz);
+}
+}  // namespace
+
+template <int Size>
+const std::array<typename BasicWorldGen<Size>::Job, BasicWorldGen<Size>::STAGE_COUNT> BasicWorldGen<Size>::jobs = {
+    Job{NONE, 0, nullptr},
+    Job{NONE, 0, &BasicWorldGen::gen_terrain},
+    Job{TERRAIN, 0, &BasicWorldGen::gen_caves},
+    Job{CAVES, 1, &BasicWorldGen::gen_decorations},
+};
+
+template <int Size>
+const char* BasicWorldGen<Size>::stage_name(Stage stage) {
+    switch (stage) {
+        case TERRAIN:
+            return "terrain";
+        case CAVES:
+            return "caves";
+        case DECORATIONS:
+            return "decorations";
+        default:
+            return "none";
+    }
+}
+
+template <int Size>
+void BasicWorldGen<Size>::generate() {
+    for (int stage = TERRAIN; stage < STAGE_COUNT; ++stage) run_stage((Stage)stage);
+}
+
+template <int Size>
+void BasicWorldGen<Size>::run_stage(Stage stage) {
+    auto& job = jobs[stage];
+
+    for (int cz = 0; cz < C::WORLD_D; ++cz)
+        for (int cx = 0; cx < C::WORLD_W; ++cx)
+            if (!is_ready(cx, cz, job))
+                throw std::runtime_error(std::string("World generation stage not ready: ") + stage_name(stage));
+
+    auto start = std::chrono::steady_clock::now();
+
+    // columns of the same color are at least 2 * radius + 1 apart, so their writes never overlap
+    int stride = 2 * job.radius + 1;
+    for (int color = 0; color < stride * stride; ++color) {
+#pragma omp parallel for
+        for (int i = 0; i < C::WORLD_AREA; ++i) {
+            int cx = i % C::WORLD_W, cz = i / C::WORLD_W;
+            if (cx % stride + stride * (cz % stride) != color) continue;
+
+            (this->*job.run)(cx, cz);
+            column_stages[i] = stage;
+        }
+    }
+
+    stage_times[stage] =
+        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <int Size>
+bool BasicWorldGen<Size>::is_ready(int cx, int cz, const Job& job) const {
+    if (column_stages[cx + C::WORLD_W * cz] != job.depends_on) return false;
+
+    for (int iz = std::max(cz - job.radius, 0); iz <= std::min(cz + job.radius, C::WORLD_D - 1); ++iz)
+        for (int ix = std::max(cx - job.radius, 0); ix <= std::min(cx + job.radius, C::WORLD_W - 1); ++ix)
+            if (column_stages[ix + C::WORLD_W * iz] < job.depends_on) return false;
+
+    return true;
+}
+
+template <int Size>
+void BasicWorldGen<Size>::gen_terrain(int cx, int cz) {
+    std::uniform_real_distribution<float> uniform_dist(0, 7);
+
+    for (int cy = 0; cy < C::WORLD_H; ++cy)
+        voxels[cx + C::WORLD_W * cz + C::WORLD_AREA * cy] = std::make_unique<typename C::Voxels>();
+
+    for (int x = 0; x < Size; ++x)
+        for (int z = 0; z < Size; ++z) {
+            int wx = x + cx * Size;
+            int wz = z + cz * Size;
+            if (wx >= C::BLOCKS_W || wz >= C::BLOCKS_D) {
+                height(wx, wz) = 0;
+                continue;
+            }
+            auto e = column_engine(TERRAIN, wx, wz);
+            int world_height = height(wx, wz) = get_height(glm::vec2(wx, wz));
+
+            for (int wy = 0; wy < std::min(world_height, C::BLOCKS_H); ++wy) {
+                int voxel_id = STONE;
+
+                if (wy == world_height - 1) {
+                    int ry = wy - (int)uniform_dist(e);
+                    if (SNOW_LVL <= ry && ry < world_height)
+                        voxel_id = SNOW;
+                    else if (STONE_LVL <= ry && ry < SNOW_LVL)
+                        voxel_id = STONE;
+                    else if (DIRT_LVL <= ry && ry < STONE_LVL)
+                        voxel_id = DIRT;
+                    else if (GRASS_LVL <= ry && ry < DIRT_LVL)
+                        voxel_id = GRASS;
+                    else
+                        voxel_id = SAND;
+                }
+
+                set_voxel(wx, wy, wz, voxel_id);
+            }
+        }
+}
+
+template <int Size>
+void BasicWorldGen<Size>::gen_caves(int cx, int cz) {
+    for (int x = 0; x < Size; ++x)
+        for (int z = 0; z < Size; ++z) {
+            int wx = x + cx * Size;
+            int wz = z + cz * Size;
+            float cave_floor = glm::simplex(glm::vec2(wx * 0.1, wz * 0.1)) * 3 + 3;
+
+            for (int wy = 0; wy < std::min(height(wx, wz) - 10, C::BLOCKS_H); ++wy)
+                if (cave_floor < wy && glm::simplex(glm::vec3(wx * 0.09, wy * 0.09, wz * 0.09)) > 0)
+                    set_voxel(wx, wy, wz, 0);
+        }
+}
+
+template <int Size>
+void BasicWorldGen<Size>::gen_decorations(int cx, int cz) {
+    std::uniform_real_distribution<float> uniform_dist;
+
+    for (int x = 0; x < Size; ++x)
+        for (int z = 0; z < Size; ++z) {
+            int wx = x + cx * Size;
+            int wz = z + cz * Size;
+            int wy = height(wx, wz) - 1;
+
+            if (wy >= DIRT_LVL || get_voxel(wx, wy, wz) != GRASS) continue;
+            auto e = column_engine(DECORATIONS, wx, wz);
+            if (uniform_dist(e) > TREE_PROBABILITY) continue;
+
+            place_tree(wx, wy, wz, e);
+        }
+}
+
+template <int Size>
+void BasicWorldGen<Size>::place_tree(int wx, int wy, int wz, std::default_random_engine& e) {
+    // the leaves only fill the air and the trunk the air or the leaves, so overlapping trees come out the same
+    // whatever order the columns are decorated in
+
+    // dirt under the tree
+    set_voxel(wx, wy, wz, DIRT);
+
+    // leaves
+    int m = 0;
+    for (int iy = TREE_H_HEIGHT; iy < TREE_HEIGHT - 1; ++iy) {
+        std::uniform_real_distribution<float> uniform_dist(0, 2);
+
+        int k = iy % 2;
+        int rng = (int)uniform_dist(e);
+        for (int ix = -TREE_H_WIDTH + m; ix < TREE_H_WIDTH - m * rng; ++ix)
+            for (int iz = -TREE_H_WIDTH + m * rng; iz < TREE_H_WIDTH - m; ++iz)
+                if ((ix + iz) % 4 && !get_voxel(wx + ix + k, wy + iy, wz + iz + k))
+                    set_voxel(wx + ix + k, wy + iy, wz + iz + k, LEAVES);
+        int n = iy - TREE_H_HEIGHT;
+        m += n > 1 ? 3 : n > 0 ? 1 : 0;
+    }
+
+    // tree trunk
+    for (int iy = 1; iy < TREE_HEIGHT - 2; ++iy) {
+        auto voxel_id = get_voxel(wx, wy + iy, wz);
+        if (!voxel_id || voxel_id == LEAVES) set_voxel(wx, wy + iy, wz, WOOD);
+    }
+
+    // top
+    if (!get_voxel(wx, wy + TREE_HEIGHT - 2, wz)) set_voxel(wx, wy + TREE_HEIGHT - 2, wz, LEAVES);
+}
+
+template <int Size>
+uint8_t BasicWorldGen<Size>::get_voxel(int wx, int wy, int wz) const {
+    int chunk_index = C::chunk_index(wx, wy, wz);
+    if (chunk_index == -1) return 0;
+
+    return (*voxels[chunk_index])[C::voxel_index(wx, wy, wz)];
+}
+
+template <int Size>
+void BasicWorldGen<Size>::set_voxel(int wx, int wy, int wz, uint8_t voxel_id) {
+    // parts of a structure outside of the world are simply dropped
+    int chunk_index = C::chunk_index(wx, wy, wz);
+    if (chunk_index == -1 || wx >= C::BLOCKS_W || wy >= C::BLOCKS_H || wz >= C::BLOCKS_D) return;
+
+    (*voxels[chunk_index])[C::voxel_index(wx, wy, wz)] = voxel_id;
+}
+
+template struct BasicWorldGen<16>;
+template struct BasicWorldGen<32>;
+template struct BasicWorldGen<48>;
+template struct BasicWorldGen<64>;
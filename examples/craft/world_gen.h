@@ -0,0 +1,53 @@
+#pragma once
+
+#include <random>
+
+#include "chunk.h"
+
+// Terrain is generated in stages, every stage is a parallel job over chunk columns.
+// A stage may write into the neighbor columns within its radius, so it is only run
+// once all of them have reached the stage it requires.
+template <int Size>
+struct BasicWorldGen {
+    enum Stage { NONE, TERRAIN, CAVES, DECORATIONS, STAGE_COUNT };
+
+    using C = Chunk<Size>;
+    using WorldVoxels = typename C::WorldVoxels;
+
+    // trees may hang into the neighbor columns, but never further
+    static_assert(TREE_H_WIDTH + 1 < Size);
+
+    BasicWorldGen(WorldVoxels& voxels) : voxels(voxels) {}
+
+    void generate();
+    void run_stage(Stage stage);
+
+    static const char* stage_name(Stage stage);
+
+    std::array<Stage, C::WORLD_AREA> column_stages{};
+    std::array<float, STAGE_COUNT> stage_times{};  // in milliseconds
+
+   private:
+    struct Job {
+        Stage depends_on;
+        int radius;  // how far (in columns) the job may write
+        void (BasicWorldGen::*run)(int cx, int cz);
+    };
+    static const std::array<Job, STAGE_COUNT> jobs;
+
+    bool is_ready(int cx, int cz, const Job& job) const;
+
+    void gen_terrain(int cx, int cz);
+    void gen_caves(int cx, int cz);
+    void gen_decorations(int cx, int cz);
+    void place_tree(int wx, int wy, int wz, std::default_random_engine& e);
+
+    uint8_t get_voxel(int wx, int wy, int wz) const;
+    void set_voxel(int wx, int wy, int wz, uint8_t voxel_id);
+    int& height(int wx, int wz) { return height_map[wx + C::WORLD_W * Size * wz]; }
+
+    WorldVoxels& voxels;
+    std::vector<int> height_map = std::vector<int>(C::WORLD_AREA * C::AREA);
+};
+
+using WorldGen = BasicWorldGen<CHUNK_SIZE>;
@@ -5,7 +5,7 @@
 struct Mesh : gltf::Shader {
     Mesh(Engine& engine, const glm::mat4& model) : engine(engine), gltf::Shader("marry.gltf", "phong", engine) {
         vert_formats = {vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32Sfloat};
-        write_uniform(2, model);  // model matrix
+        write_push_constant(model);  // model matrix
     }
 
     virtual ~Mesh() override {
@@ -25,8 +25,6 @@ struct Mesh : gltf::Shader {
                       vk::ShaderStageFlagBits::eFragment);  // specular
         write_uniform(5, glm::vec3(0),
                       vk::ShaderStageFlagBits::eFragment);  // light position
-        write_uniform(6, glm::vec3(0),
-                      vk::ShaderStageFlagBits::eFragment);  // camera position
         write_uniform(7, 5000.0f,
                       vk::ShaderStageFlagBits::eFragment);  // light intensity
         write_uniform(8, 1,
@@ -40,7 +38,6 @@ struct Mesh : gltf::Shader {
 
         auto time = engine.get_time();
         write_uniform(5, glm::vec3(sin(time * 1.5) * 100, cos(time) * 150, cos(time * 0.5) * 100));
-        write_uniform(6, engine.get_player().position);
     }
 
     Engine& engine;
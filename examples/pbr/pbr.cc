@@ -19,7 +19,7 @@ struct Mesh : gltf::PrimitiveShader {
         : engine(engine), gltf::PrimitiveShader(primitive, name, engine) {
         vert_formats = {vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32Sfloat};
 
-        write_uniform(2, glm::translate(glm::mat4(1), offset) * transform * modelMat);  // model matrix
+        write_push_constant(glm::translate(glm::mat4(1), offset) * transform * modelMat);  // model matrix
         write_uniform(9, roughness,
                       vk::ShaderStageFlagBits::eFragment);  // roughness
     }
@@ -29,8 +29,6 @@ struct Mesh : gltf::PrimitiveShader {
 
         write_uniform(3, glm::vec3(0.7216, 0.451, 0.2), vk::ShaderStageFlagBits::eFragment);  // uKd
         write_uniform(4, -lightDir, vk::ShaderStageFlagBits::eFragment);                      // light dir
-        write_uniform(5, glm::vec3(0),
-                      vk::ShaderStageFlagBits::eFragment);  // camera position
         write_uniform(6, lightRadiance,
                       vk::ShaderStageFlagBits::eFragment);  // light intensity
         write_uniform(7, lightPos,
@@ -43,12 +41,6 @@ struct Mesh : gltf::PrimitiveShader {
         write_texture(12, "GGX_Eavg_LUT.png");  // EavgLut
     }
 
-    virtual void update() override {
-        Shader::update();
-
-        write_uniform(5, engine.get_player().position);
-    }
-
     Engine& engine;
 };
 
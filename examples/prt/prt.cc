@@ -11,7 +11,7 @@ struct Marry : gltf::Shader {
     Marry(Engine& engine, const glm::mat4& model) : engine(engine), gltf::Shader("marry2.gltf", "prt", engine) {
         vert_formats = {vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32Sfloat,
                         vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat};
-        write_uniform(2, model);  // model matrix
+        write_push_constant(model);  // model matrix
     }
 
     virtual void init() override {
@@ -97,13 +97,6 @@ struct CubeMap : Shader {
                           "CornellBox/posz.jpg", "CornellBox/negz.jpg"});
     }
 
-    virtual void update() override {
-        auto view = camera->view;
-        // Cancel out translation
-        view[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-        write_uniform(1, view);
-    }
-
     virtual void pre_attach() override {
         auto renderPassBuilder = vulkan->makeRenderPassBuilder(engine.get_surface_format());
         vulkan->addRenderPass(renderPassBuilder);
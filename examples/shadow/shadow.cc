@@ -12,7 +12,7 @@ struct PhongShadow : gltf::Shader {
         : engine(engine), gltf::Shader(gltf_file, shader_file, engine) {
         vert_formats = {vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32Sfloat};
 
-        write_uniform(2, model);                        // model matrix
+        write_push_constant(model);                     // model matrix
         write_uniform(3, lightProjection * lightView);  // light VP
     }
 
@@ -34,8 +34,6 @@ struct PhongShadow : gltf::Shader {
                       vk::ShaderStageFlagBits::eFragment);  // specular
         write_uniform(6, glm::vec3(0, 80, 80),
                       vk::ShaderStageFlagBits::eFragment);  // light position
-        write_uniform(7, glm::vec3(0),
-                      vk::ShaderStageFlagBits::eFragment);  // camera position
         write_uniform(8, 5000.0f,
                       vk::ShaderStageFlagBits::eFragment);  // light intensity
 
@@ -44,12 +42,6 @@ struct PhongShadow : gltf::Shader {
 
     virtual void pre_attach() override { textures[11] = engine.get_offscreen_depth_texture(); }
 
-    virtual void update() override {
-        Shader::update();
-
-        write_uniform(7, engine.get_player().position);
-    }
-
     Engine& engine;
 };
 
@@ -59,7 +51,7 @@ struct Shadow : gltf::Shader {
         vert_formats = {vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32Sfloat};
 
         write_uniform(0, lightProjection * lightView);  // light VP
-        write_uniform(2, model);
+        write_push_constant(model);
     }
 
     virtual void init() override {
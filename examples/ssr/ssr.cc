@@ -34,7 +34,6 @@ struct SSR : Shader {
         write_vertex(positions);
 
         write_uniform(3, -lightDir, vk::ShaderStageFlagBits::eFragment);      // light dir
-        write_uniform(4, glm::vec3(0), vk::ShaderStageFlagBits::eFragment);   // camera pos
         write_uniform(5, lightRadiance, vk::ShaderStageFlagBits::eFragment);  // light radiance
         write_uniform(12, sampleNum, vk::ShaderStageFlagBits::eFragment);
     }
@@ -51,7 +50,6 @@ struct SSR : Shader {
     virtual void update() override {
         Shader::update();
 
-        write_uniform(4, engine.get_player().position);
         write_uniform(12, sampleNum);
     }
 
@@ -64,7 +62,7 @@ struct Shadow : gltf::PrimitiveShader {
         vert_formats = {vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32Sfloat};
 
         write_uniform(0, lightProjection * lightView);  // light VP
-        write_uniform(2, modelMat);                     // model matrix
+        write_push_constant(modelMat);                  // model matrix
     }
 
     virtual void init() override {
@@ -81,7 +79,7 @@ struct GBuffer : gltf::PrimitiveShader {
         : engine(engine), gltf::PrimitiveShader(primitive, "gbuffer", engine) {
         vert_formats = {vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32Sfloat};
 
-        write_uniform(2, modelMat);                     // model matrix
+        write_push_constant(modelMat);                  // model matrix
         write_uniform(3, lightProjection * lightView);  // light VP
     }
 
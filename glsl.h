@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "DirStackFileIncluder.h"
+
+// GLSL to SPIR-V, shared by the engine and the build time shader compiler, so both see the same options
+
+inline EShLanguage translateShaderStage(vk::ShaderStageFlagBits stage) {
+    switch (stage) {
+        case vk::ShaderStageFlagBits::eVertex:
+            return EShLangVertex;
+        case vk::ShaderStageFlagBits::eTessellationControl:
+            return EShLangTessControl;
+        case vk::ShaderStageFlagBits::eTessellationEvaluation:
+            return EShLangTessEvaluation;
+        case vk::ShaderStageFlagBits::eGeometry:
+            return EShLangGeometry;
+        case vk::ShaderStageFlagBits::eFragment:
+            return EShLangFragment;
+        case vk::ShaderStageFlagBits::eCompute:
+            return EShLangCompute;
+        case vk::ShaderStageFlagBits::eRaygenNV:
+            return EShLangRayGenNV;
+        case vk::ShaderStageFlagBits::eAnyHitNV:
+            return EShLangAnyHitNV;
+        case vk::ShaderStageFlagBits::eClosestHitNV:
+            return EShLangClosestHitNV;
+        case vk::ShaderStageFlagBits::eMissNV:
+            return EShLangMissNV;
+        case vk::ShaderStageFlagBits::eIntersectionNV:
+            return EShLangIntersectNV;
+        case vk::ShaderStageFlagBits::eCallableNV:
+            return EShLangCallableNV;
+        case vk::ShaderStageFlagBits::eTaskNV:
+            return EShLangTaskNV;
+        case vk::ShaderStageFlagBits::eMeshNV:
+            return EShLangMeshNV;
+        default:
+            assert(false && "Unknown shader stage");
+            return EShLangVertex;
+    }
+}
+
+// the compiler options, a cached shader is only used with the same ones
+inline const char* const GLSL_PREAMBLE = "#extension GL_GOOGLE_include_directive : enable\n";
+inline const char* const GLSL_INCLUDE_DIRECTORY = "shaders";
+inline constexpr int GLSL_DEFAULT_VERSION = 100;
+// Enable SPIR-V and Vulkan rules when parsing GLSL
+inline constexpr EShMessages GLSL_MESSAGES = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+
+// the optimizer only runs when glslang was built with SPIRV-Tools
+inline bool GLSLtoSPV(const vk::ShaderStageFlagBits shaderType, const std::string& glslShader,
+                      std::vector<unsigned int>& spvShader, bool optimize = false) {
+    EShLanguage stage = translateShaderStage(shaderType);
+
+    const char* shaderStrings[1];
+    shaderStrings[0] = glslShader.data();
+
+    glslang::TShader shader(stage);
+    shader.setStrings(shaderStrings, 1);
+    shader.setPreamble(GLSL_PREAMBLE);
+
+    EShMessages messages = GLSL_MESSAGES;
+
+    DirStackFileIncluder includer;
+    includer.pushExternalLocalDirectory(GLSL_INCLUDE_DIRECTORY);
+
+    if (!shader.parse(GetDefaultResources(), GLSL_DEFAULT_VERSION, false, messages, includer)) {
+        std::cerr << shader.getInfoLog();
+        std::cerr << shader.getInfoDebugLog();
+        return false;
+    }
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+
+    //
+    // Program-level processing...
+    //
+
+    if (!program.link(messages)) {
+        std::cerr << program.getInfoLog();
+        std::cerr << program.getInfoDebugLog();
+        return false;
+    }
+
+    glslang::SpvOptions options;
+    options.disableOptimizer = !optimize;
+    glslang::GlslangToSpv(*program.getIntermediate(stage), spvShader, &options);
+    return true;
+}
@@ -2,8 +2,11 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "gltf.h"
 
+#include <fstream>
 #include <iostream>
 
+#include "ktx.h"
+
 namespace {
 vk::SamplerAddressMode getSamplerMode(int wrapMode) {
     switch (wrapMode) {
@@ -104,7 +107,7 @@ Model::Model(Vulkan* vulkan, const std::string& filename) : vulkan(vulkan) {
     meshes.reserve(model.meshes.size());
 
     // maybe lazy load in the future
-    loadTextures();
+    loadTextures(filename.substr(0, filename.find_last_of("/\\") + 1));
     loadBufferViews();
 }
 
@@ -177,19 +180,31 @@ void Model::load(const tinygltf::Mesh& mesh) {
     meshes.push_back(newMesh);
 }
 
-void Model::loadTextures() {
+void Model::loadTextures(const std::string& directory) {
     for (auto& tex : model.textures) {
-        tinygltf::Image image = model.images[tex.source];
+        const tinygltf::Image& image = model.images[tex.source];
+        tinygltf::Sampler sampler;
+        if (tex.sampler != -1) sampler = model.samplers[tex.sampler];
+
+        // baked by tools/convert_textures next to the image file
+        ktx::Image baked;
+        auto bakedFile = directory + image.uri.substr(0, image.uri.find_last_of('.')) + ".ktx2";
+        if (!image.uri.empty() && std::ifstream(bakedFile).is_open()) baked = ktx::load(bakedFile);
+        if (!baked.levels.empty() && (baked.layers != 1 || baked.cubemap ||
+                                      baked.extent != vk::Extent2D(image.width, image.height)))
+            throw std::runtime_error("Baked texture does not match its image: " + bakedFile);
+
         Vulkan::Texture texture;
-        if (tex.sampler == -1)
-            texture = vulkan->createTexture({(uint32_t)image.width, (uint32_t)image.height}, image.image.data());
-        else {
-            auto sampler = model.samplers[tex.sampler];
+        if (!baked.levels.empty() && vulkan->isTextureFormatSupported(baked.format))
+            texture = vulkan->createTexture(baked.format, baked.extent, baked.levels, baked.layers, false, true,
+                                            getFilterMode(sampler.magFilter), getFilterMode(sampler.minFilter),
+                                            getSamplerMode(sampler.wrapS), getSamplerMode(sampler.wrapT),
+                                            getSamplerMode(sampler.wrapT));
+        else
             texture = vulkan->createTexture({(uint32_t)image.width, (uint32_t)image.height}, image.image.data(), 1,
                                             false, true, getFilterMode(sampler.magFilter),
                                             getFilterMode(sampler.minFilter), getSamplerMode(sampler.wrapS),
                                             getSamplerMode(sampler.wrapT), getSamplerMode(sampler.wrapT));
-        }
         textures.push_back(texture);
     }
 }
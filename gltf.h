@@ -66,7 +66,8 @@ struct Model {
     void load(Node* parent, const tinygltf::Node& node);
     void load(const tinygltf::Mesh& mesh);
 
-    void loadTextures();
+    // from the images of the model, or the textures baked next to them in directory
+    void loadTextures(const std::string& directory);
     void loadBufferViews() {
         for (auto& bufferView : model.bufferViews)
             bufferViews.push_back(vulkan->createGltfBuffer(
@@ -88,10 +89,12 @@ struct PrimitiveShader : ::Shader {
 
     virtual void attach(uint32_t subpass = 0) override {
         draw_id = vulkan->attachShader(vert_shader, frag_shader, primitive.vertexStrides, vert_formats, uniforms,
-                                       textures, primitive.mode, subpass, cull_mode);
+                                       textures, primitive.mode, subpass, cull_mode, true,
+                                       (uint32_t)push_constants.size());
     }
 
     virtual void draw() override {
+        if (!push_constants.empty()) vulkan->pushConstants(draw_id, push_constants.data());
         vulkan->drawIndexed(draw_id, primitive.index, primitive.indexOffset, primitive.indexType,
                             (uint32_t)primitive.indexCount, primitive.vertex, primitive.vertexOffset);
     }
@@ -110,9 +113,10 @@ struct Shader : ::Shader {
                       const std::map<int, Vulkan::Texture>& textures, uint32_t subpass, vk::CullModeFlags cullMode) {
         if (node.mesh)
             for (auto& primitive : node.mesh->primitives)
-                primitive.drawId =
-                    vulkan->attachShader(vertexShaderModule, fragmentShaderModule, primitive.vertexStrides,
-                                         vertexFormats, uniforms, textures, primitive.mode, subpass, cullMode, false);
+                primitive.drawId = vulkan->attachShader(vertexShaderModule, fragmentShaderModule,
+                                                        primitive.vertexStrides, vertexFormats, uniforms, textures,
+                                                        primitive.mode, subpass, cullMode, false,
+                                                        (uint32_t)push_constants.size());
         for (auto& child : node.children)
             attachShader(child, vertexShaderModule, fragmentShaderModule, vertexFormats, uniforms, textures, subpass,
                          cullMode);
@@ -120,9 +124,11 @@ struct Shader : ::Shader {
 
     void drawNode(const Node& node) {
         if (node.mesh)
-            for (auto& primitive : node.mesh->primitives)
+            for (auto& primitive : node.mesh->primitives) {
+                if (!push_constants.empty()) vulkan->pushConstants(primitive.drawId, push_constants.data());
                 vulkan->drawIndexed(primitive.drawId, primitive.index, primitive.indexOffset, primitive.indexType,
                                     (uint32_t)primitive.indexCount, primitive.vertex, primitive.vertexOffset);
+            }
         for (auto& child : node.children) drawNode(child);
     }
 
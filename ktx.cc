@@ -0,0 +1,188 @@
+#include "ktx.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vulkan/vulkan_format_traits.hpp>
+
+namespace {
+const unsigned char KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct Header {
+    unsigned char identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Header) == 80, "KTX2 header is 80 bytes");
+
+struct LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// the level data is aligned to a multiple of every texel block size written
+constexpr uint64_t LEVEL_ALIGNMENT = 16;
+
+template <typename T>
+void append(std::vector<char>& bytes, const T& value) {
+    bytes.insert(bytes.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value + 1));
+}
+
+struct Sample {
+    uint16_t bitOffset;
+    uint8_t bitLength;  // minus one
+    uint8_t channelType;
+    uint32_t upper;
+};
+
+// the basic data format descriptor of the formats the converter writes
+std::vector<char> makeDFD(vk::Format format) {
+    uint8_t colorModel;
+    uint8_t blockDimension;  // minus one
+    std::vector<Sample> samples;
+    switch (format) {
+        case vk::Format::eR8G8B8A8Unorm:
+            colorModel = 1;  // RGBSDA
+            blockDimension = 0;
+            samples = {{0, 7, 0, 255}, {8, 7, 1, 255}, {16, 7, 2, 255}, {24, 7, 15, 255}};
+            break;
+        case vk::Format::eBc1RgbUnormBlock:
+            colorModel = 128;  // BC1A
+            blockDimension = 3;
+            samples = {{0, 63, 0, ~0u}};
+            break;
+        case vk::Format::eBc3UnormBlock:
+            colorModel = 130;  // BC3
+            blockDimension = 3;
+            samples = {{0, 63, 15, ~0u}, {64, 63, 0, ~0u}};
+            break;
+        default:
+            throw std::runtime_error("Cannot describe texture format: " + vk::to_string(format));
+    }
+
+    std::vector<char> dfd;
+    uint16_t blockSize = uint16_t(24 + 16 * samples.size());
+    append(dfd, uint32_t(4 + blockSize));
+    append(dfd, uint32_t(0));  // Khronos basic descriptor
+    append(dfd, uint16_t(2));  // version
+    append(dfd, blockSize);
+    append(dfd, colorModel);
+    append(dfd, uint8_t(1));  // BT.709 primaries
+    append(dfd, uint8_t(1));  // linear, as the engine samples them
+    append(dfd, uint8_t(0));  // straight alpha
+    for (int i = 0; i < 4; ++i) append(dfd, uint8_t(i < 2 ? blockDimension : 0));
+    for (int i = 0; i < 8; ++i) append(dfd, uint8_t(i ? 0 : vk::blockSize(format)));
+    for (auto& sample : samples) {
+        append(dfd, sample.bitOffset);
+        append(dfd, sample.bitLength);
+        append(dfd, sample.channelType);
+        append(dfd, uint32_t(0));  // sample position
+        append(dfd, uint32_t(0));  // lower
+        append(dfd, sample.upper);
+    }
+    return dfd;
+}
+}  // namespace
+
+namespace ktx {
+
+Image load(const std::string& fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Failed to load file: " + fileName);
+    std::vector<char> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    Header header;
+    if (bytes.size() < sizeof(header)) throw std::runtime_error("Not a KTX2 file: " + fileName);
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)))
+        throw std::runtime_error("Not a KTX2 file: " + fileName);
+    if (!header.vkFormat || header.supercompressionScheme || header.pixelDepth || !header.pixelHeight ||
+        !header.levelCount || (header.faceCount != 1 && header.faceCount != 6))
+        throw std::runtime_error("Unsupported KTX2 file: " + fileName);
+
+    Image image;
+    image.format = vk::Format(header.vkFormat);
+    image.extent = vk::Extent2D(header.pixelWidth, header.pixelHeight);
+    image.layers = std::max(header.layerCount, 1u) * header.faceCount;
+    image.cubemap = header.faceCount == 6;
+
+    // no more levels than down to 1x1, each exactly the size of its blocks
+    auto blockExtent = vk::blockExtent(image.format);
+    auto blockSize = vk::blockSize(image.format);
+    auto largest = std::max(header.pixelWidth, header.pixelHeight);
+    if (!blockSize || header.levelCount > 32 || !(largest >> (header.levelCount - 1)))
+        throw std::runtime_error("Unsupported KTX2 file: " + fileName);
+
+    if (bytes.size() < sizeof(header) + header.levelCount * sizeof(LevelIndex))
+        throw std::runtime_error("Truncated KTX2 file: " + fileName);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        LevelIndex level;
+        memcpy(&level, bytes.data() + sizeof(header) + i * sizeof(level), sizeof(level));
+        if (level.byteOffset + level.byteLength > bytes.size())
+            throw std::runtime_error("Truncated KTX2 file: " + fileName);
+
+        uint64_t blocksX = (std::max(header.pixelWidth >> i, 1u) + blockExtent[0] - 1) / blockExtent[0];
+        uint64_t blocksY = (std::max(header.pixelHeight >> i, 1u) + blockExtent[1] - 1) / blockExtent[1];
+        uint64_t blocks = blocksX * blocksY;
+        if (level.byteLength != blocks * image.layers * blockSize)
+            throw std::runtime_error("Invalid KTX2 level size: " + fileName);
+        image.levels.emplace_back(bytes.begin() + level.byteOffset,
+                                  bytes.begin() + level.byteOffset + level.byteLength);
+    }
+    return image;
+}
+
+void save(const std::string& fileName, const Image& image) {
+    uint32_t faces = image.cubemap ? 6 : 1;
+    Header header = {};
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = (uint32_t)image.format;
+    header.typeSize = 1;  // of the 8 bit and block compressed formats written
+    header.pixelWidth = image.extent.width;
+    header.pixelHeight = image.extent.height;
+    header.layerCount = image.layers / faces > 1 ? image.layers / faces : 0;
+    header.faceCount = faces;
+    header.levelCount = (uint32_t)image.levels.size();
+
+    auto dfd = makeDFD(image.format);
+    header.dfdByteOffset = uint32_t(sizeof(header) + image.levels.size() * sizeof(LevelIndex));
+    header.dfdByteLength = (uint32_t)dfd.size();
+
+    // the smallest level comes first in the file
+    std::vector<LevelIndex> levels(image.levels.size());
+    uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (size_t i = levels.size(); i-- > 0;) {
+        offset = (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+        levels[i] = {offset, image.levels[i].size(), image.levels[i].size()};
+        offset += image.levels[i].size();
+    }
+
+    std::vector<char> bytes;
+    append(bytes, header);
+    for (auto& level : levels) append(bytes, level);
+    bytes.insert(bytes.end(), dfd.begin(), dfd.end());
+    for (size_t i = levels.size(); i-- > 0;) {
+        bytes.resize(levels[i].byteOffset);
+        bytes.insert(bytes.end(), image.levels[i].begin(), image.levels[i].end());
+    }
+
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size());
+    if (!file) throw std::runtime_error("Failed to write file: " + fileName);
+}
+
+}  // namespace ktx
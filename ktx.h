@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+// KTX2 textures with their whole mip chain baked offline, shared by the engine and tools/convert_textures.cc,
+// only plain 2D textures, arrays and cubemaps without supercompression are read and written
+namespace ktx {
+
+struct Image {
+    vk::Format format = vk::Format::eUndefined;
+    vk::Extent2D extent;
+    uint32_t layers = 1;   // the faces of all the cubes for a cubemap
+    bool cubemap = false;
+    std::vector<std::vector<char>> levels;  // from the largest, each holds all its layers one after another
+};
+
+Image load(const std::string& fileName);
+void save(const std::string& fileName, const Image& image);
+
+}  // namespace ktx
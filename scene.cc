@@ -6,8 +6,12 @@ void Scene::init() {
     glslang::InitializeProcess();
     load();
     for (auto& mesh : meshes) mesh->load();
+    // the loads only request their shaders, they are compiled all at once
+    vulkan->resolveShaderModules();
     glslang::FinalizeProcess();
 
     attach();
     for (auto& mesh : meshes) mesh->attach();
+    // the geometry of all the meshes in a single submission
+    vulkan->flushUploads();
 }
@@ -4,6 +4,8 @@
 
 class Scene {
    public:
+    friend class Engine;
+
     virtual ~Scene() = default;
 
     virtual void init();
@@ -22,4 +24,5 @@ class Scene {
 
    private:
     std::vector<std::unique_ptr<IShader>> meshes;
+    Vulkan* vulkan = nullptr;  // set by the engine
 };
@@ -3,7 +3,9 @@
 #include <fstream>
 #include <iostream>
 
+#include "embedded_shaders.h"
 #include "engine.h"
+#include "ktx.h"
 #include "stb_image.h"
 
 namespace {
@@ -30,6 +32,28 @@ std::vector<char> readFile(const std::string& filename) {
     if (!image) throw std::runtime_error("Failed to load texture file: assets/" + filename);
     return {image, width, height};
 }
+
+// the texture baked by tools/convert_textures next to the image, when there is one the device can sample
+bool loadBakedImage(const Vulkan& vulkan, const std::string& filename, ktx::Image& image) {
+    auto baked = filename.substr(0, filename.find_last_of('.')) + ".ktx2";
+    if (!std::ifstream(baked).is_open()) return false;
+
+    image = ktx::load(baked);
+    return vulkan.isTextureFormatSupported(image.format);
+}
+
+void loadShaderModule(Vulkan& vulkan, vk::ShaderStageFlagBits stage, const std::string& filename,
+                      vk::ShaderModule& module) {
+#ifdef EMBED_SHADERS
+    // compiled at build time, the GLSL is only read for the shaders added since
+    if (auto spv = find_embedded_shader(filename)) {
+        module = vulkan.createShaderModule(*spv);
+        return;
+    }
+#endif
+    // compiled with the other shaders of the scene, before it is attached
+    vulkan.requestShaderModule(stage, readFile(filename).data(), module, filename);
+}
 }  // namespace
 
 Shader::Shader(const std::string& name, Engine& engine)
@@ -41,36 +65,28 @@ Shader::~Shader() {
     for (auto& texture : textures) vulkan->destroyTexture(texture.second);
 }
 
-void Shader::init() {
-    auto proj = camera->proj;
-    proj[1][1] *= -1;
-    write_uniform(0, proj);
-    write_uniform(1, camera->view);
-}
-
 void Shader::load() {
-    try {
-        vert_shader = vulkan->createShaderModule(vk::ShaderStageFlagBits::eVertex,
-                                                 readFile("shaders/" + shader_name + ".vert").data());
-    } catch (const std::exception&) {
-        std::cerr << "When compiling file: shaders/" + shader_name + ".vert\n";
-        throw;
-    }
-    try {
-        frag_shader = vulkan->createShaderModule(vk::ShaderStageFlagBits::eFragment,
-                                                 readFile("shaders/" + shader_name + ".frag").data());
-    } catch (const std::exception&) {
-        std::cerr << "When compiling file: shaders/" + shader_name + ".frag\n";
-        throw;
-    }
+    loadShaderModule(*vulkan, vk::ShaderStageFlagBits::eVertex, "shaders/" + shader_name + ".vert", vert_shader);
+    loadShaderModule(*vulkan, vk::ShaderStageFlagBits::eFragment, "shaders/" + shader_name + ".frag", frag_shader);
 }
 
 void Shader::attach(uint32_t subpass) {
     draw_id = vulkan->attachShader(vert_shader, frag_shader, vertex.stride, vert_formats, uniforms, textures, subpass,
-                                   cull_mode);
+                                   cull_mode, true, true, (uint32_t)push_constants.size());
 }
 
 void Shader::write_texture(int binding, const std::string& filename, uint32_t layers) {
+    ktx::Image baked;
+    if (loadBakedImage(*vulkan, "assets/" + filename, baked)) {
+        // baked from another version of the image
+        if (baked.layers != layers || baked.cubemap)
+            throw std::runtime_error("Baked texture does not match its image: assets/" + filename);
+        auto& texture = textures[binding];
+        if (!texture.sampler)
+            texture = vulkan->createTexture(baked.format, baked.extent, baked.levels, baked.layers, baked.cubemap);
+        return;
+    }
+
     void* image;
     uint32_t width, height;
     std::tie(image, width, height) = loadImage("assets/" + filename);
@@ -51,10 +51,13 @@ struct Shader : IShader {
     Shader(const std::string &name, Engine &engine);
     virtual ~Shader();
 
-    virtual void init();
-    virtual void update() { write_uniform(1, camera->view); }
+    // the camera and the time are in the globals written by the engine, the uniforms are per mesh
+    virtual void init() {}
+    virtual void update() {}
     virtual void draw() {
-        if (draw_id != -1) vulkan->draw(draw_id, vertex);
+        if (draw_id == -1) return;
+        if (!push_constants.empty()) vulkan->pushConstants(draw_id, push_constants.data());
+        vulkan->draw(draw_id, vertex);
     }
 
     virtual void load();
@@ -63,22 +66,30 @@ struct Shader : IShader {
     template <typename T>
     void write_uniform(int binding, const T &data, vk::ShaderStageFlags stage = {}) {
         auto &buffer = uniforms[binding];
-        if (!buffer.data) buffer = vulkan->createUniformBuffer(sizeof(T));
+        if (!buffer.size) buffer = vulkan->createUniformBuffer(sizeof(T));
 
-        memcpy(buffer.data, &data, sizeof(T));
+        vulkan->writeUniform(buffer, &data);
         if (stage) buffer.stage = stage;
     }
 
+    // recorded with each draw instead of a uniform, for the small blocks of a single object like its model matrix,
+    // the type is fixed once attached
+    template <typename T>
+    void write_push_constant(const T &data) {
+        push_constants.resize(sizeof(T));
+        memcpy(push_constants.data(), &data, sizeof(T));
+    }
+
     template <typename T, size_t Size>
     void write_vertex(const std::array<T, Size> &data) {
-        if (vertex.data) vulkan->destroyVertexBuffer(vertex);
-        vertex = vulkan->createVertexBuffer(data.data(), sizeof(T), Size);
+        if (vertex.size) vulkan->destroyVertexBuffer(vertex);
+        vertex = vulkan->createVertexBuffer(data.data(), sizeof(T), Size, vertex_placement);
     }
 
     template <typename T>
     void write_vertex(const std::vector<T> &data) {
-        if (vertex.data) vulkan->destroyVertexBuffer(vertex);
-        vertex = vulkan->createVertexBuffer(data.data(), sizeof(T), data.size());
+        if (vertex.size) vulkan->destroyVertexBuffer(vertex);
+        vertex = vulkan->createVertexBuffer(data.data(), sizeof(T), data.size(), vertex_placement);
     }
 
     void write_texture(int binding, const std::string &filename, uint32_t layers = 1);
@@ -87,11 +98,17 @@ struct Shader : IShader {
     void write_texture(int binding, std::initializer_list<std::string> filenames,
                        std::initializer_list<uint32_t> index);
     void write_texture(int binding, std::array<std::string, 6> filenames);
+    void update_texture(int binding, vk::Offset2D offset, vk::Extent2D extent, uint32_t base_layer, uint32_t layers,
+                        const void *data) {
+        vulkan->updateTexture(textures.at(binding), offset, extent, base_layer, layers, data);
+    }
 
     Vulkan::Buffer vertex;
+    Vulkan::Placement vertex_placement = Vulkan::Placement::DeviceLocal;
     std::vector<vk::Format> vert_formats;
     std::map<int, Vulkan::Buffer> uniforms;
     std::map<int, Vulkan::Texture> textures;
+    std::vector<char> push_constants;
     vk::ShaderModule vert_shader = {};
     vk::ShaderModule frag_shader = {};
     std::string shader_name;
@@ -6,15 +6,70 @@ layout(location = 0) flat in int voxel_id;
 layout(location = 1) flat in int face_id;
 layout(location = 2) in vec2 uv;
 layout(location = 3) in float shading;
-layout(location = 4) in float frag_world_pos_y;
+layout(location = 4) in vec3 frag_world_pos;
+layout(location = 5) in float view_depth;
 
 layout(binding = 3) uniform bg_color_t {
     vec3 bg_color;
 };
 layout(binding = 4) uniform sampler2DArray u_texture_array;
+#include "chunk_shadow.glsl"
+layout(binding = 6) uniform sampler2D u_shadow_map0;
+layout(binding = 7) uniform sampler2D u_shadow_map1;
+layout(binding = 8) uniform sampler2D u_shadow_map2;
+layout(binding = 9) uniform sampler2D u_shadow_map3;
 
 layout(location = 0) out vec4 fragColor;
 
+const vec3 face_normals[6] = vec3[6](vec3(0, 1, 0), vec3(0, -1, 0),   // top bottom
+vec3(1, 0, 0), vec3(-1, 0, 0),   // right left
+vec3(0, 0, -1), vec3(0, 0, 1)    // back front
+);
+
+// how dark the shadowed faces get
+const float shadow_strength = 0.4;
+
+float shadow_depth(int cascade, vec2 uv) {
+    switch (cascade) {
+        case 0:
+            return textureLod(u_shadow_map0, uv, 0).r;
+        case 1:
+            return textureLod(u_shadow_map1, uv, 0).r;
+        case 2:
+            return textureLod(u_shadow_map2, uv, 0).r;
+        default:
+            return textureLod(u_shadow_map3, uv, 0).r;
+    }
+}
+
+// 1 in the sun, 0 in the shadow
+float sun_visibility() {
+    vec3 normal = face_normals[face_id];
+    if (dot(normal, sun_dir.xyz) <= 0)
+        return 0;
+
+    for (int i = 0; i < shadow_cascades; ++i) {
+        if (view_depth > cascades[i].x)
+            continue;
+
+        // pushed off the face by a texel, so it does not shadow itself
+        vec4 coords = light_vp[i] * vec4(frag_world_pos + normal * cascades[i].y, 1);
+        coords.xy = coords.xy * 0.5 + 0.5;
+        // far cascades are drawn every few frames, their box may lag behind the view
+        if (any(lessThan(coords.xyz, vec3(0))) || any(greaterThan(coords.xyz, vec3(1))))
+            continue;
+
+        // 3x3 PCF
+        vec2 texel = 1.0 / textureSize(u_shadow_map0, 0);
+        float lit = 0;
+        for (int x = -1; x <= 1; ++x)
+            for (int y = -1; y <= 1; ++y)
+                lit += coords.z > shadow_depth(i, coords.xy + vec2(x, y) * texel) ? 0 : 1;
+        return lit / 9;
+    }
+    return 1;
+}
+
 void main() {
     vec2 face_uv = uv;
     face_uv.x = (min(face_id, 2) - uv.x) / 3.0;
@@ -23,10 +78,10 @@ void main() {
     vec3 tex_col = tex.rgb;
     tex_col = pow(tex_col, gamma);
 
-    tex_col *= shading;
+    tex_col *= shading * mix(1 - shadow_strength, 1, sun_visibility());
 
     // underwater effect
-    if(frag_world_pos_y < water_line)
+    if(frag_world_pos.y < water_line)
         tex_col *= vec3(0.0, 0.3, 1.0);
 
     // fog
@@ -0,0 +1,20 @@
+// Chunks of a region, one after another in the vertex buffer (see RegionMesh::ChunkTable)
+
+const int max_region_chunks = 64;
+layout(binding = 2) uniform region_t {
+    ivec4 region_chunks[max_region_chunks];  // xyz: chunk origin, w: first vertex
+    int region_chunk_count;
+};
+
+int find_chunk() {
+    // the last chunk starting at or before this vertex, empty chunks share the start of the next one
+    int lo = 0, hi = region_chunk_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (region_chunks[mid].w <= gl_VertexIndex)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
@@ -1,22 +1,17 @@
 #version 450
 
+#include "chunk.glsl"
+
 layout(location = 0) in uint packed_data;
 
-layout(binding = 0) uniform m_proj_t {
-    mat4 m_proj;
-};
-layout(binding = 1) uniform m_view_t {
-    mat4 m_view;
-};
-layout(binding = 2) uniform m_model_t {
-    mat4 m_model;
-};
+#include "globals.glsl"
 
 layout(location = 0) out int voxel_id;
 layout(location = 1) out int face_id;
 layout(location = 2) out vec2 uv;
 layout(location = 3) out float shading;
-layout(location = 4) out float frag_world_pos_y;
+layout(location = 4) out vec3 frag_world_pos;
+layout(location = 5) out float view_depth;
 
 const float ao_values[4] = float[4](0.1, 0.25, 0.5, 1.0);
 
@@ -66,8 +61,10 @@ void main() {
 
     shading = face_shading[face_id] * ao_values[ao_id];
 
-    vec4 in_position = m_model * vec4(x, y, z, 1.0);
-    frag_world_pos_y = in_position.y;
+    vec4 in_position = vec4(region_chunks[find_chunk()].xyz + ivec3(x, y, z), 1.0);
+    frag_world_pos = in_position.xyz;
 
-    gl_Position = m_proj * m_view * in_position;
+    vec4 view_position = m_view * in_position;
+    view_depth = -view_position.z;
+    gl_Position = m_proj * view_position;
 }
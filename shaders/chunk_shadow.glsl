@@ -0,0 +1,8 @@
+// Sun shadow cascades of the chunks (see ShadowMesh::Layout), shared by chunk.frag and chunk_shadow.vert
+
+const int shadow_cascades = 4;  // SHADOW_CASCADES
+layout(binding = 5) uniform shadow_t {
+    mat4 light_vp[shadow_cascades];
+    vec4 cascades[shadow_cascades];  // x: far end in view depth, y: texel size in blocks
+    vec4 sun_dir;
+};
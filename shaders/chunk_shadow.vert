@@ -0,0 +1,12 @@
+#version 450
+
+#include "chunk.glsl"
+#include "chunk_shadow.glsl"
+
+layout(location = 0) in uint packed_data;
+
+void main() {
+    // the position bits of chunk.vert, the cascade is the instance
+    ivec3 position = ivec3(packed_data >> 26, (packed_data >> 20) & 63u, (packed_data >> 14) & 63u);
+    gl_Position = light_vp[gl_InstanceIndex] * vec4(region_chunks[find_chunk()].xyz + position, 1.0);
+}
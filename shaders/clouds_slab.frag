@@ -0,0 +1,80 @@
+#version 450
+
+#include "noise.glsl"
+
+layout(location = 0) in vec3 frag_pos;
+layout(location = 1) flat in vec3 cam_pos;
+
+#include "globals.glsl"
+layout(binding = 3) uniform bg_color_t {
+    vec3 bg_color;
+};
+// see CloudSlab::Layout
+layout(binding = 4) uniform cloud_layout_t {
+    vec2 center;
+    float scale;
+    float grid_size;
+    float bottom;
+    float top;
+};
+
+layout(location = 0) out vec4 fragColor;
+
+const vec3 cloud_color = vec3(1);
+const int max_cells = 256;
+
+// the same cells as the cloud mesh, pos moves with the wind
+vec2 cell_pos(vec2 pos) {
+    pos -= 300 * sin(0.01 * u_time);
+    return (pos - center) / scale + center;
+}
+
+bool is_cloud(vec2 cell) {
+    if (any(lessThan(cell, vec2(0))) || any(greaterThanEqual(cell, vec2(grid_size))))
+        return false;
+
+    return simplex(0.13 * cell) >= 0.2;
+}
+
+void main() {
+    // the back faces of the slab are drawn, march from where the view ray enters it
+    vec3 ray = frag_pos - cam_pos;
+    float t_end = length(ray);
+    vec3 dir = ray / t_end;
+
+    float t_bottom = (bottom - cam_pos.y) / dir.y;
+    float t_top = (top - cam_pos.y) / dir.y;
+    float t_begin = max(min(t_bottom, t_top), 0);
+    t_end = min(max(t_bottom, t_top), t_end);
+
+    // cell by cell through the grid, so no cell is skipped however grazing the ray is
+    vec2 pos = cell_pos(cam_pos.xz + t_begin * dir.xz);
+    vec2 cell = floor(pos);
+    vec2 cell_dir = dir.xz / scale;
+    vec2 cell_step = sign(cell_dir);
+    vec2 t_delta = 1.0 / max(abs(cell_dir), vec2(1e-8));
+    vec2 t_next = t_begin + mix(pos - cell, cell + 1 - pos, greaterThan(cell_step, vec2(0))) * t_delta;
+
+    float t = t_begin;
+    int i;
+    for (i = 0; i < max_cells && t < t_end; ++i) {
+        if (is_cloud(cell))
+            break;
+        if (t_next.x < t_next.y) {
+            t = t_next.x;
+            t_next.x += t_delta.x;
+            cell.x += cell_step.x;
+        } else {
+            t = t_next.y;
+            t_next.y += t_delta.y;
+            cell.y += cell_step.y;
+        }
+    }
+    if (i == max_cells || t >= t_end)
+        discard;
+
+    float fog_dist = t;
+    vec3 col = mix(cloud_color, bg_color, 1.0 - exp(-0.000001 * fog_dist * fog_dist));
+
+    fragColor = vec4(col, 0.8);
+}
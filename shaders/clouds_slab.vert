@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) in vec3 in_position;
+
+#include "globals.glsl"
+
+layout(location = 0) out vec3 frag_pos;
+layout(location = 1) flat out vec3 cam_pos;
+
+void main() {
+    frag_pos = in_position;
+    cam_pos = u_camera_pos;
+    gl_Position = m_proj * m_view * vec4(in_position, 1.0);
+}
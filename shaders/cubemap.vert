@@ -2,12 +2,7 @@
 
 layout(location = 0) in vec3 inPos;
 
-layout(binding = 0) uniform m_proj_t {
-    mat4 m_proj;
-};
-layout(binding = 1) uniform m_view_t {
-    mat4 m_view;
-};
+#include "globals.glsl"
 
 layout(location = 0) out vec3 outUVW;
 
@@ -15,5 +10,6 @@ void main() {
     outUVW = inPos;
     // Convert cubemap coordinates into Vulkan coordinate space
     outUVW.x *= -1.0;
-    gl_Position = m_proj * m_view * vec4(inPos.xyz, 1.0);
+    // the translation of the view is cancelled out, the box stays around the camera
+    gl_Position = m_proj * mat4(mat3(m_view)) * vec4(inPos.xyz, 1.0);
 }
@@ -0,0 +1,119 @@
+#version 450
+
+#include "constants.glsl"
+
+layout(location = 0) in vec3 frag_pos;
+layout(location = 1) flat in vec3 cam_pos;
+
+#include "globals.glsl"
+// see FarFieldMesh::Layout
+const int max_regions = 512;
+layout(binding = 2) uniform far_field_t {
+    uvec4 near_regions[max_regions / 128];  // a bit per region, those are meshed
+    ivec3 grid_size;  // in cells
+    int cell_size;    // in blocks
+    int region_size;  // in blocks
+    int regions_w;
+};
+layout(binding = 3) uniform bg_color_t {
+    vec3 bg_color;
+};
+layout(binding = 4) uniform sampler2DArray u_texture_array;
+// see FarGrid, r: voxel id, g/b: empty brick of brick/brick^2 cells, layers are y
+layout(binding = 5) uniform sampler2DArray u_far_grid;
+
+layout(location = 0) out vec4 fragColor;
+
+// fixed cost per pixel, whatever the view distance
+const int max_steps = 192;
+const int brick = 4;
+
+bool is_near(ivec3 cell) {
+    ivec2 region = cell.xz * cell_size / region_size;
+    int i = region.x + regions_w * region.y;
+    return ((near_regions[i / 128][i / 32 % 4] >> (i % 32)) & 1u) != 0;
+}
+
+void main() {
+    // in cells from here on
+    vec3 origin = cam_pos / cell_size;
+    vec3 dir = normalize(frag_pos - cam_pos);
+    dir = mix(dir, vec3(1e-6), equal(dir, vec3(0)));
+    vec3 inv_dir = 1 / dir;
+    bvec3 positive = greaterThan(dir, vec3(0));
+
+    // clip to the grid
+    vec3 t0 = -origin * inv_dir, t1 = (grid_size - origin) * inv_dir;
+    vec3 t_enter = min(t0, t1), t_exit = max(t0, t1);
+    float t = max(max(max(t_enter.x, t_enter.y), t_enter.z), 0);
+    float t_end = min(min(t_exit.x, t_exit.y), t_exit.z);
+
+    // the cell entered along the last crossed axis is stepped exactly, rounding could keep us on the border
+    int step_axis = -1, step_cell = 0;
+    if (t > 0) {
+        step_axis = t == t_enter.x ? 0 : t == t_enter.y ? 1 : 2;
+        step_cell = positive[step_axis] ? 0 : grid_size[step_axis] - 1;
+    }
+
+    ivec3 cell = ivec3(0);
+    int voxel_id = 0;
+    for (int i = 0; i < max_steps && t < t_end; ++i) {
+        ivec3 next = clamp(ivec3(floor(origin + t * dir)), ivec3(0), grid_size - 1);
+        // the ray is monotonic along every axis, so rounding never steps back over a crossed border
+        if (i > 0)
+            next = mix(min(next, cell), max(next, cell), positive);
+        if (step_axis != -1)
+            next[step_axis] = step_cell;
+        cell = next;
+
+        // the largest block around the cell the ray can skip
+        vec3 lo, size;
+        if (is_near(cell)) {
+            int cells = region_size / cell_size;
+            lo = vec3(cell.x / cells * cells, 0, cell.z / cells * cells);
+            size = vec3(cells, grid_size.y, cells);
+        } else {
+            vec4 texel = texelFetch(u_far_grid, cell.xzy, 0);
+            int block = texel.b > 0.5 ? brick * brick : texel.g > 0.5 ? brick : 1;
+            voxel_id = block == 1 ? int(texel.r * 255 + 0.5) : 0;
+            if (voxel_id != 0)
+                break;
+
+            lo = vec3(cell / block * block);
+            size = vec3(block);
+        }
+
+        vec3 exits = (mix(lo, lo + size, positive) - origin) * inv_dir;
+        step_axis = exits.x < exits.y ? (exits.x < exits.z ? 0 : 2) : (exits.y < exits.z ? 1 : 2);
+        step_cell = int(positive[step_axis] ? lo[step_axis] + size[step_axis] : lo[step_axis] - 1);
+        if (step_cell < 0 || step_cell >= grid_size[step_axis])
+            break;
+        t = exits[step_axis];
+    }
+    if (voxel_id == 0)
+        discard;
+
+    // composited with the near meshes by the depth test
+    vec3 hit = (origin + t * dir) * cell_size;
+    vec4 clip = m_proj * m_view * vec4(hit, 1);
+    gl_FragDepth = clip.z / clip.w;
+
+    // the last mip of a block is its average color
+    vec3 tex_col = pow(textureLod(u_texture_array, vec3(0.5, 0.5, voxel_id), 16).rgb, gamma);
+
+    // the same face shading as the chunks
+    float shading = 1.0;
+    if (step_axis == 1)
+        shading = positive.y ? 0.5 : 1.0;
+    else if (step_axis != -1)
+        shading = positive[step_axis] ? 0.8 : 0.5;
+    tex_col *= shading;
+
+    if (hit.y < water_line)
+        tex_col *= vec3(0.0, 0.3, 1.0);
+
+    float fog_dist = t * cell_size;
+    tex_col = mix(tex_col, bg_color, (1.0 - exp2(-0.00001 * fog_dist * fog_dist)));
+
+    fragColor = vec4(pow(tex_col, inv_gamma), 1);
+}
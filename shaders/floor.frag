@@ -16,9 +16,7 @@ layout(binding = 5) uniform uKs_t {
 layout(binding = 6) uniform uLightPos_t {
     vec3 uLightPos;
 };
-layout(binding = 7) uniform uCameraPos_t {
-    vec3 uCameraPos;
-};
+#include "globals.glsl"
 layout(binding = 8) uniform uLightIntensity_t {
     float uLightIntensity;
 };
@@ -36,7 +34,7 @@ void main(void) {
     vec3 color = uKd;
 
     color = pow(color, gamma);
-    color = blinnPhong(color, 0.05, color, uLightIntensity, uKs, uLightIntensity, uLightPos, uCameraPos, vFragPos, vNormal, 32);
+    color = blinnPhong(color, 0.05, color, uLightIntensity, uKs, uLightIntensity, uLightPos, u_camera_pos, vFragPos, vNormal, 32);
     color = pow(color, inv_gamma);
 
     fragColor = vec4(color * visibility, 1.0);
@@ -0,0 +1,8 @@
+// the constants of the frame written once by the engine for all the draws, see Engine::Globals
+layout(set = 2, binding = 0) uniform globals_t {
+    mat4 m_proj;
+    mat4 m_view;
+    vec3 u_camera_pos;
+    float u_time;
+    vec2 u_resolution;
+};
@@ -10,9 +10,7 @@ layout(binding = 3) uniform uKd_t {
 layout(binding = 4) uniform uLightDir_t {
     vec3 uLightDir;
 };
-layout(binding = 5) uniform uCameraPos_t {
-    vec3 uCameraPos;
-};
+#include "globals.glsl"
 layout(binding = 6) uniform uLightRadiance_t {
     vec3 uLightRadiance;
 };
@@ -73,7 +71,7 @@ void main(void) {
     vec3 albedo = pow(color.rgb, vec3(2.2));
 
     vec3 N = normalize(vNormal);
-    vec3 V = normalize(uCameraPos - vFragPos);
+    vec3 V = normalize(u_camera_pos - vFragPos);
     float NdotV = max(dot(N, V), 0.0);
 
     vec3 F0 = vec3(0.04);
@@ -4,13 +4,8 @@ layout(location = 0) in vec3 aNormalPosition;
 layout(location = 1) in vec3 aVertexPosition;
 layout(location = 2) in vec2 aTextureCoord;
 
-layout(binding = 0) uniform m_proj_t {
-  mat4 m_proj;
-};
-layout(binding = 1) uniform m_view_t {
-  mat4 m_view;
-};
-layout(binding = 2) uniform m_model_t {
+#include "globals.glsl"
+layout(push_constant) uniform m_model_t {
   mat4 m_model;
 };
 
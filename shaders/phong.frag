@@ -15,9 +15,7 @@ layout(binding = 4) uniform uKs_t {
 layout(binding = 5) uniform uLightPos_t {
     vec3 uLightPos;
 };
-layout(binding = 6) uniform uCameraPos_t {
-    vec3 uCameraPos;
-};
+#include "globals.glsl"
 layout(binding = 7) uniform uLightIntensity_t {
     float uLightIntensity;
 };
@@ -39,7 +37,7 @@ void main(void) {
     }
 
     color = pow(color, gamma);
-    color = blinnPhong(color, 0.05, color, uLightIntensity, uKs, uLightIntensity, uLightPos, uCameraPos, vFragPos, vNormal, 32);
+    color = blinnPhong(color, 0.05, color, uLightIntensity, uKs, uLightIntensity, uLightPos, u_camera_pos, vFragPos, vNormal, 32);
     color = pow(color, inv_gamma);
 
     fragColor = vec4(color, 1.0);
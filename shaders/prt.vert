@@ -7,13 +7,8 @@ layout(location = 3) in vec3 aPrecomputeLT0;
 layout(location = 4) in vec3 aPrecomputeLT1;
 layout(location = 5) in vec3 aPrecomputeLT2;
 
-layout(binding = 0) uniform m_proj_t {
-    mat4 m_proj;
-};
-layout(binding = 1) uniform m_view_t {
-    mat4 m_view;
-};
-layout(binding = 2) uniform m_model_t {
+#include "globals.glsl"
+layout(push_constant) uniform m_model_t {
     mat4 m_model;
 };
 layout(binding = 3) uniform uPrecomputeL_t {
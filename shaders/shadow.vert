@@ -5,7 +5,7 @@ layout(location = 1) in vec3 aVertexPosition;
 layout(binding = 0) uniform uLightVP_t {
   mat4 uLightVP;
 };
-layout(binding = 2) uniform m_model_t {
+layout(push_constant) uniform m_model_t {
   mat4 m_model;
 };
 
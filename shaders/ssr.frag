@@ -6,9 +6,7 @@ layout(location = 1) in mat4 vWorldToScreen;
 layout(binding = 3) uniform uLightDir_t {
     vec3 uLightDir;
 };
-layout(binding = 4) uniform uCameraPos_t {
-    vec3 uCameraPos;
-};
+#include "globals.glsl"
 layout(binding = 5) uniform uLightRadiance_t {
     vec3 uLightRadiance;
 };
@@ -223,7 +221,7 @@ void main() {
 
     vec3 worldPos = GetGBufferPosWorld(vScreenUV);
     vec3 wi = normalize(uLightDir);
-    vec3 wo = normalize(uCameraPos - worldPos);
+    vec3 wo = normalize(u_camera_pos - worldPos);
 
     vec3 L = EvalDiffuse(wi, wo, vScreenUV) * EvalDirectionalLight(vScreenUV);
 
@@ -2,12 +2,7 @@
 
 layout(location = 0) in vec2 aVertexPosition;
 
-layout(binding = 0) uniform m_proj_t {
-    mat4 m_proj;
-};
-layout(binding = 1) uniform m_view_t {
-    mat4 m_view;
-};
+#include "globals.glsl"
 
 layout(location = 0) out vec2 vScreenUV;
 layout(location = 1) out mat4 vWorldToScreen;
@@ -3,17 +3,11 @@
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec2 in_tex_coord;
 
-layout(binding = 0) uniform m_proj_t {
-    uniform mat4 m_proj;
-};
-layout(binding = 1) uniform m_view_t {
-    uniform mat4 m_view;
-};
-layout(binding = 2) uniform m_model_t {
-    uniform mat4 m_model;
-};
-layout(binding = 3) uniform mode_id_t {
-    uniform uint mode_id;
+#include "globals.glsl"
+// see VoxelMarkerMesh::PushConstants
+layout(push_constant) uniform push_t {
+    mat4 m_model;
+    uint mode_id;
 };
 
 layout(location = 0) out vec3 marker_color;
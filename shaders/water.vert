@@ -5,12 +5,7 @@
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec2 in_tex_coord;
 
-layout(binding = 0) uniform m_proj_t {
-    mat4 m_proj;
-};
-layout(binding = 1) uniform m_view_t {
-    mat4 m_view;
-};
+#include "globals.glsl"
 
 layout(location = 0) out vec2 uv;
 
@@ -0,0 +1,56 @@
+// Compiles the shaders at build time into a source file of the engine, see embedded_shaders.h.
+// usage: compile_shaders <output.cc> <shaders/name.vert|frag>..., run from the directory holding shaders/
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "glsl.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <output.cc> <shader>...\n";
+        return 1;
+    }
+
+    std::ostringstream arrays, entries;
+    glslang::InitializeProcess();
+    for (int i = 2; i < argc; ++i) {
+        std::string file = argv[i];
+        auto extension = file.substr(file.find_last_of('.') + 1);
+        auto stage = extension == "vert"   ? vk::ShaderStageFlagBits::eVertex
+                     : extension == "frag" ? vk::ShaderStageFlagBits::eFragment
+                                           : vk::ShaderStageFlagBits::eCompute;
+
+        std::ifstream input(file, std::ios::binary);
+        std::string text{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+        std::vector<unsigned int> spv;
+        if (!input || !GLSLtoSPV(stage, text, spv, true)) {
+            std::cerr << "When compiling file: " << file << "\n";
+            return 1;
+        }
+
+        arrays << "const unsigned int shader_" << i << "[] = {";
+        for (size_t j = 0; j < spv.size(); ++j) arrays << (j % 8 ? " " : "\n    ") << spv[j] << "u,";
+        arrays << "\n};\n";
+        entries << "        {\"" << file << "\", {std::begin(shader_" << i << "), std::end(shader_" << i << ")}},\n";
+    }
+    glslang::FinalizeProcess();
+
+    std::ofstream output(argv[1], std::ios::trunc);
+    output << "// generated by compile_shaders, do not edit\n"
+              "#include <iterator>\n"
+              "#include <unordered_map>\n\n"
+              "#include \"embedded_shaders.h\"\n\n"
+              "namespace {\n"
+           << arrays.str()
+           << "}  // namespace\n\n"
+              "const std::vector<unsigned int>* find_embedded_shader(const std::string& file) {\n"
+              "    static const std::unordered_map<std::string, std::vector<unsigned int>> shaders = {\n"
+           << entries.str()
+           << "    };\n"
+              "    auto it = shaders.find(file);\n"
+              "    return it == shaders.end() ? nullptr : &it->second;\n"
+              "}\n";
+    return output ? 0 : 1;
+}
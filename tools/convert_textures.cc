@@ -0,0 +1,199 @@
+// Converts images to KTX2 with their whole mip chain, BC1 when opaque and BC3 otherwise, see ktx.h.
+// usage: convert_textures [--layers <count>] [--rgba] <image>..., each is written next to it as <name>.ktx2,
+// --layers splits the images stacked vertically into an array, --rgba keeps the texels uncompressed
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "ktx.h"
+#include "stb_image.h"
+
+namespace {
+struct Rgba {
+    uint8_t r, g, b, a;
+};
+
+// halves a level of each layer, the odd texels at the edge are averaged with themselves
+std::vector<Rgba> downsample(const std::vector<Rgba>& texels, uint32_t width, uint32_t height, uint32_t layers) {
+    uint32_t w = std::max(width / 2, 1u), h = std::max(height / 2, 1u);
+    std::vector<Rgba> result(w * h * layers);
+    for (uint32_t l = 0; l < layers; ++l)
+        for (uint32_t y = 0; y < h; ++y)
+            for (uint32_t x = 0; x < w; ++x) {
+                uint32_t sum[4] = {};
+                for (uint32_t j = 0; j < 4; ++j) {
+                    uint32_t sx = std::min(2 * x + j % 2, width - 1), sy = std::min(2 * y + j / 2, height - 1);
+                    auto& texel = texels[(l * height + sy) * width + sx];
+                    sum[0] += texel.r, sum[1] += texel.g, sum[2] += texel.b, sum[3] += texel.a;
+                }
+                result[(l * h + y) * w + x] = {uint8_t((sum[0] + 2) / 4), uint8_t((sum[1] + 2) / 4),
+                                               uint8_t((sum[2] + 2) / 4), uint8_t((sum[3] + 2) / 4)};
+            }
+    return result;
+}
+
+uint16_t to565(int r, int g, int b) {
+    return uint16_t((r * 31 + 127) / 255 << 11 | (g * 63 + 127) / 255 << 5 | (b * 31 + 127) / 255);
+}
+
+void from565(uint16_t c, int rgb[3]) {
+    rgb[0] = (c >> 11) * 255 / 31;
+    rgb[1] = (c >> 5 & 63) * 255 / 63;
+    rgb[2] = (c & 31) * 255 / 31;
+}
+
+// the endpoints are the corners of the bounding box of the colors, inset against the outliers
+void encodeColor(const Rgba block[16], char* output) {
+    int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        const uint8_t rgb[3] = {block[i].r, block[i].g, block[i].b};
+        for (int c = 0; c < 3; ++c) lo[c] = std::min<int>(lo[c], rgb[c]), hi[c] = std::max<int>(hi[c], rgb[c]);
+    }
+    for (int c = 0; c < 3; ++c) {
+        int inset = (hi[c] - lo[c]) / 16;
+        lo[c] += inset, hi[c] -= inset;
+    }
+
+    uint16_t c0 = to565(hi[0], hi[1], hi[2]), c1 = to565(lo[0], lo[1], lo[2]);
+    // c0 > c1 selects the four color mode, equal endpoints need no indices
+    if (c0 < c1) std::swap(c0, c1);
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        int palette[4][3];
+        from565(c0, palette[0]);
+        from565(c1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            const int rgb[3] = {block[i].r, block[i].g, block[i].b};
+            int best = 0, bestError = INT32_MAX;
+            for (int p = 0; p < 4; ++p) {
+                int error = 0;
+                for (int c = 0; c < 3; ++c) error += (rgb[c] - palette[p][c]) * (rgb[c] - palette[p][c]);
+                if (error < bestError) best = p, bestError = error;
+            }
+            indices |= uint32_t(best) << (2 * i);
+        }
+    }
+    memcpy(output, &c0, 2);
+    memcpy(output + 2, &c1, 2);
+    memcpy(output + 4, &indices, 4);
+}
+
+// eight alphas interpolated between the extremes of the block
+void encodeAlpha(const Rgba block[16], char* output) {
+    uint8_t a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i) a0 = std::max(a0, block[i].a), a1 = std::min(a1, block[i].a);
+
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        int palette[8] = {a0, a1};
+        for (int p = 1; p < 7; ++p) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            for (int p = 1; p < 8; ++p)
+                if (std::abs(block[i].a - palette[p]) < std::abs(block[i].a - palette[best])) best = p;
+            indices |= uint64_t(best) << (3 * i);
+        }
+    }
+    output[0] = char(a0);
+    output[1] = char(a1);
+    memcpy(output + 2, &indices, 6);
+}
+
+std::vector<char> compress(const std::vector<Rgba>& texels, uint32_t width, uint32_t height, uint32_t layers,
+                           bool alpha) {
+    uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockSize = alpha ? 16 : 8;
+    std::vector<char> result(blocksX * blocksY * layers * blockSize);
+    char* output = result.data();
+    for (uint32_t l = 0; l < layers; ++l)
+        for (uint32_t by = 0; by < blocksY; ++by)
+            for (uint32_t bx = 0; bx < blocksX; ++bx, output += blockSize) {
+                // the blocks past the edge repeat its texels
+                Rgba block[16];
+                for (uint32_t i = 0; i < 16; ++i) {
+                    uint32_t x = std::min(bx * 4 + i % 4, width - 1), y = std::min(by * 4 + i / 4, height - 1);
+                    block[i] = texels[(l * height + y) * width + x];
+                }
+                if (alpha) encodeAlpha(block, output);
+                encodeColor(block, alpha ? output + 8 : output);
+            }
+    return result;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " [--layers <count>] [--rgba] <image>...\n";
+        return 1;
+    }
+
+    uint32_t layers = 1;
+    bool rgba = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--layers" && i + 1 < argc) {
+            layers = std::max(std::atoi(argv[++i]), 1);
+            continue;
+        } else if (arg == "--rgba") {
+            rgba = true;
+            continue;
+        }
+
+        int width, height;
+        stbi_uc* pixels = stbi_load(arg.c_str(), &width, &height, nullptr, STBI_rgb_alpha);
+        if (!pixels || height % layers) {
+            std::cerr << "Failed to load texture file: " << arg << "\n";
+            return 1;
+        }
+        std::vector<Rgba> texels(width * height);
+        memcpy(texels.data(), pixels, texels.size() * sizeof(Rgba));
+        stbi_image_free(pixels);
+
+        bool alpha = std::any_of(texels.begin(), texels.end(), [](const Rgba& texel) { return texel.a != 255; });
+
+        ktx::Image image;
+        image.format = rgba    ? vk::Format::eR8G8B8A8Unorm
+                       : alpha ? vk::Format::eBc3UnormBlock
+                               : vk::Format::eBc1RgbUnormBlock;
+        image.extent = vk::Extent2D(width, height / layers);
+        image.layers = layers;
+
+        // the same chain as the mips blitted by the engine
+        uint32_t w = image.extent.width, h = image.extent.height;
+        uint32_t mipLevels = (uint32_t)std::log2(std::max(w, h)) + 1;
+        size_t bytes = 0, rgbaBytes = 0;  // of the whole chain, in video memory too
+        for (uint32_t level = 0; level < mipLevels; ++level) {
+            if (level) {
+                texels = downsample(texels, w, h, layers);
+                w = std::max(w / 2, 1u), h = std::max(h / 2, 1u);
+            }
+            rgbaBytes += texels.size() * sizeof(Rgba);
+            if (rgba)
+                image.levels.emplace_back(reinterpret_cast<const char*>(texels.data()),
+                                          reinterpret_cast<const char*>(texels.data() + texels.size()));
+            else
+                image.levels.push_back(compress(texels, w, h, layers, alpha));
+            bytes += image.levels.back().size();
+        }
+
+        auto output = arg.substr(0, arg.find_last_of('.')) + ".ktx2";
+        try {
+            ktx::save(output, image);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        std::cout << arg << " -> " << output << " " << vk::to_string(image.format) << ", " << mipLevels << " mips, "
+                  << bytes / 1024 << " KB instead of " << rgbaBytes / 1024 << " KB as RGBA8\n";
+    }
+    return 0;
+}
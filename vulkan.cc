@@ -1,98 +1,34 @@
 #define VMA_IMPLEMENTATION
 #include "vulkan.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <glslang/Public/ShaderLang.h>
 #include <iostream>
+#include <omp.h>
+#include <set>
+#include <sstream>
 #include <vulkan/vulkan_format_traits.hpp>
 
-#include "DirStackFileIncluder.h"
+#include "glsl.h"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
+thread_local Vulkan::Recorder* Vulkan::threadRecorder = nullptr;
+
 namespace {
 template <typename T>
 constexpr const T& clamp(const T& v, const T& lo, const T& hi) {
     return v < lo ? lo : hi < v ? hi : v;
 }
 
-EShLanguage translateShaderStage(vk::ShaderStageFlagBits stage) {
-    switch (stage) {
-        case vk::ShaderStageFlagBits::eVertex:
-            return EShLangVertex;
-        case vk::ShaderStageFlagBits::eTessellationControl:
-            return EShLangTessControl;
-        case vk::ShaderStageFlagBits::eTessellationEvaluation:
-            return EShLangTessEvaluation;
-        case vk::ShaderStageFlagBits::eGeometry:
-            return EShLangGeometry;
-        case vk::ShaderStageFlagBits::eFragment:
-            return EShLangFragment;
-        case vk::ShaderStageFlagBits::eCompute:
-            return EShLangCompute;
-        case vk::ShaderStageFlagBits::eRaygenNV:
-            return EShLangRayGenNV;
-        case vk::ShaderStageFlagBits::eAnyHitNV:
-            return EShLangAnyHitNV;
-        case vk::ShaderStageFlagBits::eClosestHitNV:
-            return EShLangClosestHitNV;
-        case vk::ShaderStageFlagBits::eMissNV:
-            return EShLangMissNV;
-        case vk::ShaderStageFlagBits::eIntersectionNV:
-            return EShLangIntersectNV;
-        case vk::ShaderStageFlagBits::eCallableNV:
-            return EShLangCallableNV;
-        case vk::ShaderStageFlagBits::eTaskNV:
-            return EShLangTaskNV;
-        case vk::ShaderStageFlagBits::eMeshNV:
-            return EShLangMeshNV;
-        default:
-            assert(false && "Unknown shader stage");
-            return EShLangVertex;
-    }
-}
-
-bool GLSLtoSPV(const vk::ShaderStageFlagBits shaderType, const std::string& glslShader,
-               std::vector<unsigned int>& spvShader) {
-    EShLanguage stage = translateShaderStage(shaderType);
-
-    const char* shaderStrings[1];
-    shaderStrings[0] = glslShader.data();
-
-    glslang::TShader shader(stage);
-    shader.setStrings(shaderStrings, 1);
-    shader.setPreamble("#extension GL_GOOGLE_include_directive : enable\n");
-
-    // Enable SPIR-V and Vulkan rules when parsing GLSL
-    EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
-
-    DirStackFileIncluder includer;
-    includer.pushExternalLocalDirectory("shaders");
-
-    if (!shader.parse(GetDefaultResources(), 100, false, messages, includer)) {
-        std::cerr << shader.getInfoLog();
-        std::cerr << shader.getInfoDebugLog();
-        return false;
-    }
-
-    glslang::TProgram program;
-    program.addShader(&shader);
-
-    //
-    // Program-level processing...
-    //
-
-    if (!program.link(messages)) {
-        std::cerr << program.getInfoLog();
-        std::cerr << program.getInfoDebugLog();
-        return false;
-    }
-
-    glslang::GlslangToSpv(*program.getIntermediate(stage), spvShader);
-    return true;
-}
-
 void setImageLayout(const vk::CommandBuffer& commandBuffer, vk::Image image, vk::Format format,
                     vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevel = 0,
-                    uint32_t layerCount = 1, uint32_t mipCount = 1) {
+                    uint32_t layerCount = 1, uint32_t mipCount = 1, uint32_t srcQueueFamily = vk::QueueFamilyIgnored,
+                    uint32_t dstQueueFamily = vk::QueueFamilyIgnored) {
     vk::AccessFlags sourceAccessMask;
     switch (oldLayout) {
         case vk::ImageLayout::eTransferDstOptimal:
@@ -104,6 +40,8 @@ void setImageLayout(const vk::CommandBuffer& commandBuffer, vk::Image image, vk:
         case vk::ImageLayout::ePreinitialized:
             sourceAccessMask = vk::AccessFlagBits::eHostWrite;
             break;
+        case vk::ImageLayout::eShaderReadOnlyOptimal:  // a write after the reads only waits for them
+            [[fallthrough]];
         case vk::ImageLayout::eGeneral:  // sourceAccessMask is empty
             [[fallthrough]];
         case vk::ImageLayout::eUndefined:
@@ -128,6 +66,9 @@ void setImageLayout(const vk::CommandBuffer& commandBuffer, vk::Image image, vk:
         case vk::ImageLayout::eUndefined:
             sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
             break;
+        case vk::ImageLayout::eShaderReadOnlyOptimal:
+            sourceStage = vk::PipelineStageFlagBits::eFragmentShader;
+            break;
         default:
             assert(false);
             break;
@@ -198,7 +139,7 @@ void setImageLayout(const vk::CommandBuffer& commandBuffer, vk::Image image, vk:
     }
 
     vk::ImageMemoryBarrier imageMemoryBarrier(sourceAccessMask, destinationAccessMask, oldLayout, newLayout,
-                                              vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, image,
+                                              srcQueueFamily, dstQueueFamily, image,
                                               {aspectMask, mipLevel, mipCount, 0, layerCount});
     commandBuffer.pipelineBarrier(sourceStage, destinationStage, {}, nullptr, nullptr, imageMemoryBarrier);
 }
@@ -272,11 +213,161 @@ std::pair<vk::Image, VmaAllocation> createImage(const VmaAllocator& vmaAllocator
     return {image, imageMemory};
 }
 
+// written ahead of the cache data, the driver only checks its own header
+struct PipelineCacheHeader {
+    uint32_t magic;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+};
+constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43504b56;  // VKPC
+
+PipelineCacheHeader makePipelineCacheHeader(const vk::PhysicalDeviceProperties& properties, size_t dataSize) {
+    PipelineCacheHeader header = {PIPELINE_CACHE_MAGIC, properties.vendorID, properties.deviceID,
+                                  properties.driverVersion};
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+    header.dataSize = dataSize;
+    return header;
+}
+
+// the bytes of the state an object is created from, padding excluded
+struct StateKey {
+    std::string bytes;
+
+    template <typename T>
+    StateKey& add(const T& value) {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        return *this;
+    }
+};
+
+// a descriptor as read by an update template, the same stride for every binding
+union DescriptorInfo {
+    VkDescriptorBufferInfo buffer;
+    VkDescriptorImageInfo image;
+};
+
+// uploads larger than the ring get a staging buffer of their own
+constexpr vk::DeviceSize STAGING_RING_SIZE = 16 << 20;
+constexpr vk::DeviceSize STAGING_ALIGNMENT = 16;
+// those buffers are pooled once their upload is done, up to this size
+constexpr vk::DeviceSize STAGING_POOL_SIZE = 64 << 20;
+
+// of the draws reading the uploaded geometry
+constexpr vk::AccessFlags GEOMETRY_READ_ACCESS =
+    vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eUniformRead;
+constexpr vk::PipelineStageFlags GEOMETRY_READ_STAGES = vk::PipelineStageFlagBits::eVertexInput |
+                                                        vk::PipelineStageFlagBits::eVertexShader |
+                                                        vk::PipelineStageFlagBits::eFragmentShader;
+
+// of the blocks the draws declare in attachShader()
+constexpr vk::ShaderStageFlags PUSH_CONSTANT_STAGES =
+    vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+
+// of each slot of a chunk of the uniform ring, a larger block gets a chunk of its own
+constexpr vk::DeviceSize UNIFORM_CHUNK_SIZE = 64 << 10;
+
+// of the first descriptor pool, each has room for as many descriptors of each type per set
+constexpr uint32_t DESCRIPTOR_POOL_SETS = 64;
+constexpr uint32_t DESCRIPTORS_PER_SET = 8;
+
+uint64_t hashBytes(const void* data, size_t size) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * 0x100000001b3;
+    return hash;
+}
+
+uint64_t hashSPV(const std::vector<unsigned int>& spv) { return hashBytes(spv.data(), spv.size() * sizeof(spv[0])); }
+
+// appends the path and text of every file a shader includes, each once, looked up like DirStackFileIncluder does
+void appendIncludes(const std::string& text, const std::string& directory, std::set<std::string>& included,
+                    std::string& sources) {
+    std::istringstream lines(text);
+    for (std::string line; std::getline(lines, line);) {
+        auto pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos || line[pos] != '#') continue;
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos || line.compare(pos, 7, "include")) continue;
+        auto begin = line.find('"', pos);
+        auto end = begin == std::string::npos ? begin : line.find('"', begin + 1);
+        if (end == std::string::npos) continue;
+
+        auto name = line.substr(begin + 1, end - begin - 1);
+        for (auto& dir : {directory, std::string(GLSL_INCLUDE_DIRECTORY)}) {
+            auto path = dir + "/" + name;
+            std::ifstream file(path, std::ios::binary);
+            if (!file) continue;
+
+            if (included.insert(path).second) {
+                std::string content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+                sources += path + '\n' + content;
+                appendIncludes(content, path.substr(0, path.find_last_of("/\\")), included, sources);
+            }
+            break;
+        }
+    }
+}
+
+// bumped when the cached files or their keys change
+constexpr uint32_t SPV_CACHE_VERSION = 1;
+
+bool readSPV(const std::string& fileName, std::vector<unsigned int>& spv) {
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    auto size = (size_t)file.tellg();
+    if (!size || size % sizeof(spv[0])) return false;
+    spv.resize(size / sizeof(spv[0]));
+    file.seekg(0);
+    // a torn or foreign file is compiled again
+    return file.read(reinterpret_cast<char*>(spv.data()), size) && spv[0] == 0x07230203;
+}
+
+void writeSPV(const std::string& fileName, const std::vector<unsigned int>& spv) {
+    auto tempFile = fileName + ".tmp";
+    {
+        std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(spv.data()), spv.size() * sizeof(spv[0]));
+        if (!file) return;
+    }
+    std::remove(fileName.c_str());
+    std::rename(tempFile.c_str(), fileName.c_str());
+}
+
 bool isDepthFormat(const vk::Format format) {
     for (uint8_t i = 0; i < vk::componentCount(format); ++i)
         if (*vk::componentName(format, i) == 'D') return true;
     return false;
 }
+
+vk::DeviceSize rgbaBytes(vk::Extent2D extent, uint32_t layers, uint32_t mipLevels) {
+    vk::DeviceSize bytes = 0;
+    for (uint32_t i = 0; i < mipLevels; ++i)
+        bytes += (vk::DeviceSize)std::max(extent.width >> i, 1u) * std::max(extent.height >> i, 1u) * layers * 4;
+    return bytes;
+}
+
+// from the copied mips in transfer source layout, leaves all of them shader readable
+void generateMips(const vk::CommandBuffer& commandBuffer, vk::Image image, vk::Format format, vk::Extent2D extent,
+                  uint32_t layers, uint32_t copiedLevels, uint32_t mipLevels) {
+    for (uint32_t i = copiedLevels; i < mipLevels; ++i) {
+        vk::ImageBlit imageBlit({vk::ImageAspectFlagBits::eColor, i - 1, 0, layers},
+                                {{{}, {int32_t(extent.width >> (i - 1)), int32_t(extent.height >> (i - 1)), 1}}},
+                                {vk::ImageAspectFlagBits::eColor, i, 0, layers},
+                                {{{}, {int32_t(extent.width >> i), int32_t(extent.height >> i), 1}}});
+        setImageLayout(commandBuffer, image, format, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                       i, layers);
+        commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image,
+                                vk::ImageLayout::eTransferDstOptimal, imageBlit, vk::Filter::eLinear);
+        setImageLayout(commandBuffer, image, format, vk::ImageLayout::eTransferDstOptimal,
+                       vk::ImageLayout::eTransferSrcOptimal, i, layers);
+    }
+    setImageLayout(commandBuffer, image, format, vk::ImageLayout::eTransferSrcOptimal,
+                   vk::ImageLayout::eShaderReadOnlyOptimal, 0, layers, mipLevels);
+}
 }  // namespace
 
 Vulkan::~Vulkan() {
@@ -284,7 +375,26 @@ Vulkan::~Vulkan() {
         device.waitIdle();
 
         frame.destroy(device, commandPool);
+        for (auto& recorder : recorders)
+            for (auto& commandPool : recorder.commandPools) device.destroyCommandPool(commandPool);
+        savePipelineCache();
+        device.destroyPipelineCache(pipelineCache);
         destroySwapChain();
+        collectUploads();
+        stagingOverflow.insert(stagingOverflow.end(), stagingPool.begin(), stagingPool.end());
+        for (auto& staging : stagingOverflow) {
+            vmaUnmapMemory(vmaAllocator, staging.memory);
+            vmaDestroyBuffer(vmaAllocator, staging.buffer, staging.memory);
+        }
+        device.destroySemaphore(uploadSemaphore);
+        if (stagingRing.size) {
+            vmaUnmapMemory(vmaAllocator, stagingRing.memory);
+            vmaDestroyBuffer(vmaAllocator, stagingRing.buffer, stagingRing.memory);
+        }
+        for (auto& chunk : uniformChunks) {
+            vmaUnmapMemory(vmaAllocator, chunk.buffer.memory);
+            vmaDestroyBuffer(vmaAllocator, chunk.buffer.buffer, chunk.buffer.memory);
+        }
         vmaDestroyAllocator(vmaAllocator);
 
         for (auto& renderResource : renderResources) {
@@ -292,14 +402,17 @@ Vulkan::~Vulkan() {
             device.destroyRenderPass(renderResource.renderPass);
         }
 
-        for (auto& drawResource : drawResources) {
-            device.destroyPipeline(drawResource.graphicsPipeline);
-            device.destroyPipelineLayout(drawResource.pipelineLayout);
-            device.destroyDescriptorPool(drawResource.descriptorPool);
-            device.destroyDescriptorSetLayout(drawResource.descriptorSetLayout);
+        for (auto& pipeline : pipelines) device.destroyPipeline(pipeline.second);
+        for (auto& pipelineLayout : pipelineLayouts) device.destroyPipelineLayout(pipelineLayout.second);
+        for (auto& descriptorPool : descriptorPools) device.destroyDescriptorPool(descriptorPool);
+        for (auto& descriptorLayout : descriptorLayouts) {
+            device.destroyDescriptorUpdateTemplate(descriptorLayout.second.updateTemplate);
+            device.destroyDescriptorSetLayout(descriptorLayout.second.setLayout);
         }
+        device.destroyDescriptorSetLayout(globalSetLayout);
+        device.destroyDescriptorSetLayout(emptySetLayout);
 
-        device.freeCommandBuffers(commandPool, commandBuffer);
+        device.destroyCommandPool(transferCommandPool);
         device.destroyCommandPool(commandPool);
         device.destroy();
     }
@@ -343,15 +456,25 @@ Vulkan& Vulkan::setDeviceFeatures(const vk::PhysicalDeviceFeatures& features) {
     deviceFeatures = features;
     return *this;
 }
+Vulkan& Vulkan::setPipelineCacheFile(const std::string& fileName) {
+    pipelineCacheFile = fileName;
+    return *this;
+}
+Vulkan& Vulkan::setShaderCacheDir(const std::string& dirName) {
+    shaderCacheDir = dirName;
+    return *this;
+}
 
 void Vulkan::init(vk::Extent2D extent, std::function<vk::SurfaceKHR(const vk::Instance&)> getSurfaceKHR,
                   uint32_t renderPassCount, std::function<bool(const vk::PhysicalDevice&)> pickDevice) {
     initInstance();
     enumerateDevice(pickDevice);
     initDevice(getSurfaceKHR);
+    initPipelineCache();
     initSwapChain(extent);
     initCommandBuffer();
     frame.init(device, commandPool);
+    initRecorders();
 
     renderResources.resize(renderPassCount);
 };
@@ -372,12 +495,14 @@ void Vulkan::addRenderPass(const RenderPassBuilder& builder) {
 uint32_t Vulkan::attachShader(vk::ShaderModule vertexShaderModule, vk::ShaderModule fragmentShaderModule,
                               uint32_t vertexStride, const std::vector<vk::Format>& vertexFormats,
                               const std::map<int, Buffer>& uniforms, const std::map<int, Texture>& textures,
-                              uint32_t subpass, vk::CullModeFlags cullMode, bool autoDestroy) {
+                              uint32_t subpass, vk::CullModeFlags cullMode, bool autoDestroy, bool blendEnable,
+                              uint32_t pushConstantSize) {
     drawResources.push_back({});
+    drawResources.back().pushConstantSize = pushConstantSize;
 
     if (!uniforms.empty() || !textures.empty()) initDescriptorSet(uniforms, textures);
-    uint32_t drawId =
-        initPipeline(vertexShaderModule, fragmentShaderModule, vertexStride, vertexFormats, subpass, cullMode);
+    uint32_t drawId = initPipeline(vertexShaderModule, fragmentShaderModule, vertexStride, vertexFormats, subpass,
+                                   cullMode, blendEnable, pushConstantSize);
 
     if (autoDestroy) {
         destroyShaderModule(fragmentShaderModule);
@@ -391,12 +516,13 @@ uint32_t Vulkan::attachShader(vk::ShaderModule vertexShaderModule, vk::ShaderMod
                               const std::vector<uint32_t>& vertexStrides, const std::vector<vk::Format>& vertexFormats,
                               const std::map<int, Buffer>& uniforms, const std::map<int, Texture>& textures,
                               vk::PrimitiveTopology primitiveTopology, uint32_t subpass, vk::CullModeFlags cullMode,
-                              bool autoDestroy) {
+                              bool autoDestroy, uint32_t pushConstantSize) {
     drawResources.push_back({});
+    drawResources.back().pushConstantSize = pushConstantSize;
 
     if (!uniforms.empty() || !textures.empty()) initDescriptorSet(uniforms, textures);
     uint32_t drawId = initPipeline(vertexShaderModule, fragmentShaderModule, vertexStrides, vertexFormats,
-                                   primitiveTopology, subpass, cullMode);
+                                   primitiveTopology, subpass, cullMode, pushConstantSize);
 
     if (autoDestroy) {
         destroyShaderModule(fragmentShaderModule);
@@ -407,7 +533,13 @@ uint32_t Vulkan::attachShader(vk::ShaderModule vertexShaderModule, vk::ShaderMod
 }
 
 void Vulkan::renderBegin() {
+    flushUploads();
     device.waitForFences(frame.drawFence(), vk::True, std::numeric_limits<uint64_t>::max());
+    beginUniformFrame();
+    for (auto& recorder : recorders) {
+        device.resetCommandPool(recorder.commandPools[frame.current]);
+        recorder.used = 0;
+    }
 
     auto currentBuffer =
         device.acquireNextImageKHR(swapChain, std::numeric_limits<uint64_t>::max(), frame.imageAcquiredSemaphore());
@@ -427,69 +559,166 @@ void Vulkan::renderBegin() {
     if (isDepthFormat(renderPassBuilder().attachmentDescriptions.back().format))
         clearValues.back().depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
 
+    auto extent = renderExtent();
     vk::RenderPassBeginInfo renderPassBeginInfo(renderPass(), framebuffers()[currentBuffer.value],
-                                                vk::Rect2D(vk::Offset2D(0, 0), imageExtent), clearValues);
+                                                vk::Rect2D(vk::Offset2D(0, 0), extent), clearValues);
 
     frame.commandBuffer().begin(vk::CommandBufferBeginInfo());
-    frame.commandBuffer().beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-    frame.commandBuffer().setViewport(0, vk::Viewport(0, 0, (float)imageExtent.width, (float)imageExtent.height, 0, 1));
-    frame.commandBuffer().setScissor(0, vk::Rect2D({0, 0}, imageExtent));
+    frame.commandBuffer().beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+    passBegun = true;
+    subpassIndex = 0;
 
     this->currentBuffer = currentBuffer.value;
 }
 
-void Vulkan::draw(uint32_t i, const Buffer& vertex) {
-    frame.commandBuffer().bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline(i));
+void Vulkan::bind(uint32_t i, const Buffer& vertex, vk::DeviceSize offset) {
+    commandBuffer().bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline(i));
     if (descriptorSet(i))
-        frame.commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), 0,
-                                                 descriptorSet(i), nullptr);
+        commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), 0,
+                                           descriptorSet(i), uniformOffsets(i));
     if (!renderPassBuilder().descriptorSets.empty())
-        frame.commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), 1,
-                                                 renderPassBuilder().descriptorSets[currentBuffer], nullptr);
-    frame.commandBuffer().bindVertexBuffers(0, vertex.buffer, {0});
-    frame.commandBuffer().draw((uint32_t)vertex.size / vertex.stride, 1, 0, 0);
+        commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), 1,
+                                           renderPassBuilder().descriptorSets[currentBuffer], nullptr);
+    if (globalSet)
+        commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), GLOBAL_SET,
+                                           globalSet, uint32_t(frame.current * globalSlotSize));
+    commandBuffer().bindVertexBuffers(0, vertex.buffer, offset);
+}
+
+void Vulkan::draw(uint32_t i, const Buffer& vertex) {
+    bind(i, vertex);
+    drawVertices(0, (uint32_t)vertex.size / vertex.stride);
+}
+
+void Vulkan::drawVertices(uint32_t firstVertex, uint32_t vertexCount, uint32_t firstInstance) {
+    commandBuffer().draw(vertexCount, 1, firstVertex, firstInstance);
 }
 
 void Vulkan::drawIndexed(uint32_t i, const vk::Buffer& index, vk::DeviceSize indexOffset, vk::IndexType indexType,
                          uint32_t count, const std::vector<vk::Buffer>& vertex,
                          const std::vector<vk::DeviceSize>& vertexOffset) {
-    frame.commandBuffer().bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline(i));
+    commandBuffer().bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline(i));
     if (descriptorSet(i))
-        frame.commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), 0,
-                                                 descriptorSet(i), nullptr);
+        commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), 0,
+                                           descriptorSet(i), uniformOffsets(i));
     if (!renderPassBuilder().descriptorSets.empty())
-        frame.commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), 1,
-                                                 renderPassBuilder().descriptorSets[currentBuffer], nullptr);
-    frame.commandBuffer().bindVertexBuffers(0, vertex, vertexOffset);
-    frame.commandBuffer().bindIndexBuffer(index, indexOffset, indexType);
-    frame.commandBuffer().pushConstants<uint32_t>(pipelineLayout(i), vk::ShaderStageFlagBits::eAll, 0, i);
-    frame.commandBuffer().drawIndexed(count, 1, 0, 0, 0);
+        commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), 1,
+                                           renderPassBuilder().descriptorSets[currentBuffer], nullptr);
+    if (globalSet)
+        commandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout(i), GLOBAL_SET,
+                                           globalSet, uint32_t(frame.current * globalSlotSize));
+    commandBuffer().bindVertexBuffers(0, vertex, vertexOffset);
+    commandBuffer().bindIndexBuffer(index, indexOffset, indexType);
+    if (!drawResources[i].pushConstantSize)
+        commandBuffer().pushConstants<uint32_t>(pipelineLayout(i), vk::ShaderStageFlagBits::eAll, 0, i);
+    commandBuffer().drawIndexed(count, 1, 0, 0, 0);
 }
 
-void Vulkan::nextSubpass() { frame.commandBuffer().nextSubpass(vk::SubpassContents::eInline); }
+void Vulkan::pushConstants(uint32_t i, const void* data) {
+    assert(drawResources[i].pushConstantSize);
+    commandBuffer().pushConstants(pipelineLayout(i), PUSH_CONSTANT_STAGES, 0,
+                                  drawResources[i].pushConstantSize, data);
+}
 
-void Vulkan::nextPass() {
+void Vulkan::recordParallel(int count, const std::function<void(int)>& task) {
+    // what the main thread recorded before goes first
+    if (auto commandBuffer = endRecording(recorders.front())) subpassCommands.push_back(commandBuffer);
+
+    // a few more batches than workers to balance them, each a contiguous range of the tasks
+    int workers = int(recorders.size() - 1);
+    int batches = std::min(count, workers * 4);
+    std::vector<vk::CommandBuffer> commandBuffers(batches);
+#pragma omp parallel for schedule(dynamic) num_threads(workers)
+    for (int b = 0; b < batches; ++b) {
+        threadRecorder = &recorders[1 + omp_get_thread_num()];
+        for (int i = b * count / batches; i < (b + 1) * count / batches; ++i) task(i);
+        commandBuffers[b] = endRecording(*threadRecorder);
+        threadRecorder = nullptr;
+    }
+    for (auto& commandBuffer : commandBuffers)
+        if (commandBuffer) subpassCommands.push_back(commandBuffer);
+}
+
+const vk::CommandBuffer& Vulkan::commandBuffer() {
+    auto& recorder = this->recorder();
+    if (recorder.current) return recorder.current;
+
+    auto& commandBuffers = recorder.commandBuffers[frame.current];
+    if (recorder.used == commandBuffers.size()) {
+        vk::CommandBufferAllocateInfo allocateInfo(recorder.commandPools[frame.current],
+                                                   vk::CommandBufferLevel::eSecondary, 1);
+        commandBuffers.push_back(device.allocateCommandBuffers(allocateInfo).front());
+    }
+    recorder.current = commandBuffers[recorder.used++];
+
+    // the dynamic state is not inherited from the primary
+    auto extent = renderExtent();
+    vk::CommandBufferInheritanceInfo inheritanceInfo(renderPass(), subpassIndex, framebuffers()[currentBuffer]);
+    recorder.current.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                                vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+                            &inheritanceInfo});
+    recorder.current.setViewport(0, vk::Viewport(0, 0, (float)extent.width, (float)extent.height, 0, 1));
+    recorder.current.setScissor(0, vk::Rect2D({0, 0}, extent));
+    return recorder.current;
+}
+
+vk::CommandBuffer Vulkan::endRecording(Recorder& recorder) {
+    auto commandBuffer = recorder.current;
+    if (commandBuffer) commandBuffer.end();
+    recorder.current = nullptr;
+    return commandBuffer;
+}
+
+void Vulkan::executeSubpass() {
+    if (auto commandBuffer = endRecording(recorders.front())) subpassCommands.push_back(commandBuffer);
+    if (!subpassCommands.empty()) frame.commandBuffer().executeCommands(subpassCommands);
+    subpassCommands.clear();
+}
+
+void Vulkan::nextSubpass() {
+    executeSubpass();
+    frame.commandBuffer().nextSubpass(vk::SubpassContents::eSecondaryCommandBuffers);
+    ++subpassIndex;
+}
+
+void Vulkan::nextPass(bool skip) {
+    if (passBegun) {
+        executeSubpass();
+        frame.commandBuffer().endRenderPass();
+    }
     ++renderIndex;
 
+    passBegun = !skip;
+    if (skip) return;
+
     std::vector<vk::ClearValue> clearValues(renderPassBuilder().attachmentDescriptions.size(), vk::ClearColorValue{});
     clearValues.front().color = bgColor;
     if (isDepthFormat(renderPassBuilder().attachmentDescriptions.back().format))
         clearValues.back().depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
 
+    auto extent = renderExtent();
     vk::RenderPassBeginInfo renderPassBeginInfo(renderPass(), framebuffers()[currentBuffer],
-                                                vk::Rect2D(vk::Offset2D(0, 0), imageExtent), clearValues);
+                                                vk::Rect2D(vk::Offset2D(0, 0), extent), clearValues);
 
-    frame.commandBuffer().endRenderPass();
-    frame.commandBuffer().beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+    frame.commandBuffer().beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+    subpassIndex = 0;
 }
 
 void Vulkan::renderEnd() {
-    frame.commandBuffer().endRenderPass();
+    if (passBegun) {
+        executeSubpass();
+        frame.commandBuffer().endRenderPass();
+    }
     frame.commandBuffer().end();
 
-    vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-    graphicsQueue.submit(vk::SubmitInfo(frame.imageAcquiredSemaphore(), waitDestinationStageMask, frame.commandBuffer(),
-                                        frame.imageRenderedSemaphore()),
+    // for the uploads flushed before it too, the wait value of the binary semaphore is ignored
+    std::array<vk::Semaphore, 2> waitSemaphores = {frame.imageAcquiredSemaphore(), uploadSemaphore};
+    std::array<vk::PipelineStageFlags, 2> waitDestinationStageMasks = {
+        vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eAllCommands};
+    std::array<uint64_t, 2> waitValues = {0, uploadValue};
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo(waitValues);
+    graphicsQueue.submit(vk::SubmitInfo(waitSemaphores, waitDestinationStageMasks, frame.commandBuffer(),
+                                        frame.imageRenderedSemaphore(), &timelineSubmitInfo),
                          frame.drawFence());
 
     auto result = presentationQueue.presentKHR({frame.imageRenderedSemaphore(), swapChain, currentBuffer});
@@ -504,143 +733,485 @@ void Vulkan::renderEnd() {
 
 void Vulkan::resize(vk::Extent2D extent) {
     device.waitIdle();
-    destroySwapChain();
+    destroySwapChain(true);
     initSwapChain(extent);
 
-    for (renderIndex = 0; renderIndex < renderResources.size(); ++renderIndex) initFrameBuffers();
+    for (renderIndex = 0; renderIndex < renderResources.size(); ++renderIndex)
+        if (!renderPassBuilder().extent.width) initFrameBuffers();
 }
 
 Vulkan::Buffer Vulkan::createUniformBuffer(vk::DeviceSize size) {
-    Buffer buffer;
-    std::tie(buffer.buffer, buffer.memory) =
-        createBuffer(vmaAllocator, size, vk::BufferUsageFlagBits::eUniformBuffer,
-                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    auto alignedSize = (size + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+
+    uint32_t block;
+    auto freed = std::find_if(freeUniformBlocks.begin(), freeUniformBlocks.end(),
+                              [&](uint32_t i) { return uniformBlocks[i].size == alignedSize; });
+    if (freed != freeUniformBlocks.end()) {
+        block = *freed;
+        freeUniformBlocks.erase(freed);
+    } else {
+        auto chunk = std::find_if(uniformChunks.begin(), uniformChunks.end(), [&](const UniformChunk& chunk) {
+            return chunk.head + alignedSize <= chunk.slotSize;
+        });
+        if (chunk == uniformChunks.end()) {
+            UniformChunk newChunk;
+            newChunk.slotSize = std::max(UNIFORM_CHUNK_SIZE, alignedSize);
+            newChunk.buffer.size = newChunk.slotSize * FrameInFlight::FRAME_IN_FLIGHT;
+            std::tie(newChunk.buffer.buffer, newChunk.buffer.memory) =
+                createBuffer(vmaAllocator, newChunk.buffer.size, vk::BufferUsageFlagBits::eUniformBuffer,
+                             vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+            vmaMapMemory(vmaAllocator, newChunk.buffer.memory, &newChunk.buffer.data);
+            chunk = uniformChunks.insert(uniformChunks.end(), newChunk);
+        }
+
+        block = (uint32_t)uniformBlocks.size();
+        uniformBlocks.push_back({uint32_t(chunk - uniformChunks.begin()), chunk->head, alignedSize});
+        chunk->head += alignedSize;
+    }
+    uniformBlocks[block].data.resize(size);
 
+    Buffer buffer;
+    buffer.buffer = uniformChunks[uniformBlocks[block].chunk].buffer.buffer;
     buffer.stride = 0;
     buffer.size = size;
-    vmaMapMemory(vmaAllocator, buffer.memory, &buffer.data);
+    buffer.block = block;
 
+    // zeroed until it is written
+    writeUniform(buffer, std::vector<char>(size).data());
     return buffer;
 }
 
+void Vulkan::writeUniform(const Buffer& buffer, const void* data) {
+    beginUniformFrame();
+
+    auto& block = uniformBlocks[buffer.block];
+    memcpy(block.data.data(), data, block.data.size());
+    memcpy(uniformData(buffer.block, frame.current), data, block.data.size());
+    block.stale = FrameInFlight::FRAME_IN_FLIGHT - 1;
+}
+
 void Vulkan::destroyUniformBuffer(const Buffer& buffer) {
     if (buffer.size) {
-        vmaUnmapMemory(vmaAllocator, buffer.memory);
+        // the frames in flight may still read it, a slot is only rewritten after the fence of its frame
+        uniformBlocks[buffer.block].stale = 0;
+        freeUniformBlocks.push_back(buffer.block);
+    }
+}
+
+void Vulkan::setGlobalUniform(const Buffer& buffer) {
+    // the layouts of the draws attached before would miss it
+    assert(drawResources.empty() && !globalSet);
+
+    vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eUniformBufferDynamic, 1, buffer.stage);
+    globalSetLayout = device.createDescriptorSetLayout({{}, binding});
+    globalSet = allocateDescriptorSet(globalSetLayout);
+
+    auto& block = uniformBlocks[buffer.block];
+    vk::DescriptorBufferInfo bufferInfo(buffer.buffer, block.offset, buffer.size);
+    device.updateDescriptorSets(
+        vk::WriteDescriptorSet(globalSet, 0, 0, vk::DescriptorType::eUniformBufferDynamic, nullptr, bufferInfo),
+        nullptr);
+    globalSlotSize = uniformChunks[block.chunk].slotSize;
+}
+
+void Vulkan::beginUniformFrame() {
+    if (uniformFrame == frame.count) return;
+    uniformFrame = frame.count;
+
+    // the writes before renderBegin() go to the slot of the frame submitted FRAME_IN_FLIGHT frames ago
+    device.waitForFences(frame.drawFence(), vk::True, std::numeric_limits<uint64_t>::max());
+    for (uint32_t i = 0; i < uniformBlocks.size(); ++i) {
+        auto& block = uniformBlocks[i];
+        if (!block.stale) continue;
+        memcpy(uniformData(i, frame.current), block.data.data(), block.data.size());
+        --block.stale;
+    }
+}
+
+char* Vulkan::uniformData(uint32_t block, int slot) {
+    auto& chunk = uniformChunks[uniformBlocks[block].chunk];
+    return static_cast<char*>(chunk.buffer.data) + slot * chunk.slotSize + uniformBlocks[block].offset;
+}
+
+const std::vector<uint32_t>& Vulkan::uniformOffsets(uint32_t i) {
+    auto& dynamicOffsets = recorder().dynamicOffsets;
+    dynamicOffsets.clear();
+    for (auto slotSize : drawResources[i].uniformSlots) dynamicOffsets.push_back(uint32_t(frame.current * slotSize));
+    return dynamicOffsets;
+}
+
+Vulkan::Buffer Vulkan::createVertexBuffer(const void* vertices, uint32_t stride, size_t size, Placement placement) {
+    auto buffer = createGeometryBuffer(vertices, stride * size, vk::BufferUsageFlagBits::eVertexBuffer, placement);
+    buffer.stride = stride;
+    return buffer;
+}
+
+void Vulkan::destroyVertexBuffer(const Buffer& buffer) {
+    if (buffer.size) {
+        unstageBuffer(buffer);
         vmaDestroyBuffer(vmaAllocator, buffer.buffer, buffer.memory);
     }
 }
 
-Vulkan::Buffer Vulkan::createVertexBuffer(const void* vertices, uint32_t stride, size_t size) {
+Vulkan::Buffer Vulkan::createDynamicVertexBuffer(uint32_t stride, size_t size) {
     Buffer buffer;
     buffer.stride = stride;
     buffer.size = stride * size;
 
     std::tie(buffer.buffer, buffer.memory) =
-        createBuffer(vmaAllocator, buffer.size, vk::BufferUsageFlagBits::eVertexBuffer,
+        createBuffer(vmaAllocator, buffer.size * FrameInFlight::FRAME_IN_FLIGHT, vk::BufferUsageFlagBits::eVertexBuffer,
                      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-
     vmaMapMemory(vmaAllocator, buffer.memory, &buffer.data);
-    memcpy(buffer.data, vertices, buffer.size);
-    vmaUnmapMemory(vmaAllocator, buffer.memory);
 
     return buffer;
 }
 
-void Vulkan::destroyVertexBuffer(const Buffer& buffer) {
-    if (buffer.size) vmaDestroyBuffer(vmaAllocator, buffer.buffer, buffer.memory);
+void Vulkan::destroyDynamicVertexBuffer(const Buffer& buffer) {
+    if (buffer.size) {
+        vmaUnmapMemory(vmaAllocator, buffer.memory);
+        vmaDestroyBuffer(vmaAllocator, buffer.buffer, buffer.memory);
+    }
 }
 
-Vulkan::Buffer Vulkan::createGltfBuffer(const void* data, size_t size) {
-    Buffer buffer;
+Vulkan::Buffer Vulkan::createGltfBuffer(const void* data, size_t size, Placement placement) {
+    auto buffer = createGeometryBuffer(data, size,
+                                       vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer |
+                                           vk::BufferUsageFlagBits::eUniformBuffer,
+                                       placement);
     buffer.stride = -1;
+    return buffer;
+}
+void Vulkan::destroyGltfBuffer(const Buffer& buffer) {
+    if (buffer.size) {
+        unstageBuffer(buffer);
+        vmaDestroyBuffer(vmaAllocator, buffer.buffer, buffer.memory);
+    }
+}
+
+Vulkan::Buffer Vulkan::createGeometryBuffer(const void* data, size_t size, vk::BufferUsageFlags usage,
+                                            Placement placement) {
+    Buffer buffer;
     buffer.size = size;
 
-    std::tie(buffer.buffer, buffer.memory) =
-        createBuffer(vmaAllocator, buffer.size,
-                     vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer |
-                         vk::BufferUsageFlagBits::eUniformBuffer,
-                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    if (placement == Placement::HostVisible) {
+        std::tie(buffer.buffer, buffer.memory) =
+            createBuffer(vmaAllocator, buffer.size, usage,
+                         vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
 
-    vmaMapMemory(vmaAllocator, buffer.memory, &buffer.data);
-    memcpy(buffer.data, data, buffer.size);
-    vmaUnmapMemory(vmaAllocator, buffer.memory);
+        void* mapped;
+        vmaMapMemory(vmaAllocator, buffer.memory, &mapped);
+        memcpy(mapped, data, buffer.size);
+        vmaUnmapMemory(vmaAllocator, buffer.memory);
+        return buffer;
+    }
 
+    std::tie(buffer.buffer, buffer.memory) = createBuffer(vmaAllocator, buffer.size,
+                                                          usage | vk::BufferUsageFlagBits::eTransferDst,
+                                                          vk::MemoryPropertyFlagBits::eDeviceLocal);
+    stageBuffer(buffer, data);
     return buffer;
 }
-void Vulkan::destroyGltfBuffer(const Buffer& buffer) {
-    if (buffer.size) vmaDestroyBuffer(vmaAllocator, buffer.buffer, buffer.memory);
+
+std::pair<vk::Buffer, vk::DeviceSize> Vulkan::stageData(const void* data, vk::DeviceSize size) {
+    if (!stagingRing.size) {
+        stagingRing.size = STAGING_RING_SIZE;
+        std::tie(stagingRing.buffer, stagingRing.memory) =
+            createBuffer(vmaAllocator, stagingRing.size, vk::BufferUsageFlagBits::eTransferSrc,
+                         vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        vmaMapMemory(vmaAllocator, stagingRing.memory, &stagingRing.data);
+    }
+
+    if (size > stagingRing.size) {
+        // the smallest pooled buffer large enough, or a new one of a power of two size
+        auto it = stagingPool.end();
+        for (auto pooled = stagingPool.begin(); pooled != stagingPool.end(); ++pooled)
+            if (pooled->size >= size && (it == stagingPool.end() || pooled->size < it->size)) it = pooled;
+
+        Buffer staging;
+        if (it != stagingPool.end()) {
+            staging = *it;
+            stagingPool.erase(it);
+            stagingPoolSize -= staging.size;
+        } else {
+            staging.size = stagingRing.size;
+            while (staging.size < size) staging.size *= 2;
+            std::tie(staging.buffer, staging.memory) =
+                createBuffer(vmaAllocator, staging.size, vk::BufferUsageFlagBits::eTransferSrc,
+                             vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+            vmaMapMemory(vmaAllocator, staging.memory, &staging.data);
+        }
+
+        memcpy(staging.data, data, size);
+        stagingOverflow.push_back(staging);
+        return {staging.buffer, 0};
+    }
+
+    // the uploads not flushed yet are submitted before the ring wraps
+    auto offset = (stagingHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    if (offset + size > stagingRing.size) {
+        flushUploads();
+        stagingBegin = offset = 0;
+    }
+    // and the part of it the batches in flight still copy from is waited for
+    uint64_t value = 0;
+    for (auto& batch : uploadBatches)
+        if (batch.stagingBegin < offset + size && offset < batch.stagingEnd) value = batch.value;
+    if (value) waitUploads(value);
+
+    memcpy(static_cast<char*>(stagingRing.data) + offset, data, size);
+    stagingHead = offset + size;
+    return {stagingRing.buffer, offset};
+}
+
+void Vulkan::stageBuffer(const Buffer& buffer, const void* data) {
+    auto staging = stageData(data, buffer.size);
+    stagedCopies.push_back({staging.first, buffer.buffer, {staging.second, 0, buffer.size}});
+}
+
+void Vulkan::unstageBuffer(const Buffer& buffer) {
+    // destroyed before its copy was flushed
+    stagedCopies.erase(std::remove_if(stagedCopies.begin(), stagedCopies.end(),
+                                      [&](const StagedCopy& copy) { return copy.destination == buffer.buffer; }),
+                       stagedCopies.end());
+
+    // or before it was done
+    uint64_t value = 0;
+    for (auto& batch : uploadBatches)
+        if (std::find(batch.buffers.begin(), batch.buffers.end(), buffer.buffer) != batch.buffers.end())
+            value = batch.value;
+    if (value) waitUploads(value);
+}
+
+void Vulkan::unstageImage(const vk::Image& image) {
+    stagedImages.erase(std::remove_if(stagedImages.begin(), stagedImages.end(),
+                                      [&](const StagedImage& staged) { return staged.image == image; }),
+                       stagedImages.end());
+
+    uint64_t value = 0;
+    for (auto& batch : uploadBatches)
+        if (std::find(batch.images.begin(), batch.images.end(), image) != batch.images.end()) value = batch.value;
+    if (value) waitUploads(value);
+}
+
+uint64_t Vulkan::flushUploads() {
+    collectUploads();
+    if (stagedCopies.empty() && stagedImages.empty()) return uploadValue;
+
+    // a transfer queue of another family releases what it wrote, and the graphics queue acquires it
+    bool transferFamily = transferQueueFamilyIndex != graphicsQueueFamliyIndex;
+    uint32_t srcQueueFamily = transferFamily ? transferQueueFamilyIndex : vk::QueueFamilyIgnored;
+    uint32_t dstQueueFamily = transferFamily ? graphicsQueueFamliyIndex : vk::QueueFamilyIgnored;
+
+    UploadBatch batch;
+    batch.transferCommands =
+        device.allocateCommandBuffers({transferCommandPool, vk::CommandBufferLevel::ePrimary, 1}).front();
+    auto& transfer = batch.transferCommands;
+    transfer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+    std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+    for (auto& copy : stagedCopies) {
+        transfer.copyBuffer(copy.source, copy.destination, copy.region);
+        bufferBarriers.emplace_back(vk::AccessFlagBits::eTransferWrite,
+                                    transferFamily ? vk::AccessFlags() : GEOMETRY_READ_ACCESS, srcQueueFamily,
+                                    dstQueueFamily, copy.destination, 0, VK_WHOLE_SIZE);
+        batch.buffers.push_back(copy.destination);
+    }
+    // released to the graphics family, or made visible to the draws on the same queue
+    vk::PipelineStageFlags releaseStages =
+        transferFamily ? vk::PipelineStageFlags(vk::PipelineStageFlagBits::eBottomOfPipe) : GEOMETRY_READ_STAGES;
+    if (!bufferBarriers.empty())
+        transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, releaseStages, {}, nullptr, bufferBarriers,
+                                 nullptr);
+
+    for (auto& staged : stagedImages) {
+        batch.images.push_back(staged.image);
+        if (staged.patch) continue;
+        auto copiedLevels = (uint32_t)staged.regions.size();
+        setImageLayout(transfer, staged.image, staged.format, vk::ImageLayout::eUndefined,
+                       vk::ImageLayout::eTransferDstOptimal, 0, staged.layers, copiedLevels);
+        transfer.copyBufferToImage(staged.source, staged.image, vk::ImageLayout::eTransferDstOptimal, staged.regions);
+        // released in the layout the mips are blitted from
+        setImageLayout(transfer, staged.image, staged.format, vk::ImageLayout::eTransferDstOptimal,
+                       vk::ImageLayout::eTransferSrcOptimal, 0, staged.layers, copiedLevels, srcQueueFamily,
+                       dstQueueFamily);
+    }
+
+    // blits need a graphics queue
+    if (transferFamily) {
+        batch.graphicsCommands =
+            device.allocateCommandBuffers({commandPool, vk::CommandBufferLevel::ePrimary, 1}).front();
+        batch.graphicsCommands.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    }
+    auto& graphics = transferFamily ? batch.graphicsCommands : transfer;
+
+    if (transferFamily && !bufferBarriers.empty()) {
+        for (auto& bufferBarrier : bufferBarriers) {
+            bufferBarrier.setSrcAccessMask({});
+            bufferBarrier.setDstAccessMask(GEOMETRY_READ_ACCESS);
+        }
+        graphics.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, GEOMETRY_READ_STAGES, {}, nullptr,
+                                 bufferBarriers, nullptr);
+    }
+    for (auto& staged : stagedImages) {
+        // in place, the barrier waits for the frames submitted before on the same queue
+        if (staged.patch) {
+            setImageLayout(graphics, staged.image, staged.format, vk::ImageLayout::eShaderReadOnlyOptimal,
+                           vk::ImageLayout::eTransferDstOptimal, 0, staged.layers);
+            graphics.copyBufferToImage(staged.source, staged.image, vk::ImageLayout::eTransferDstOptimal,
+                                       staged.regions);
+            setImageLayout(graphics, staged.image, staged.format, vk::ImageLayout::eTransferDstOptimal,
+                           vk::ImageLayout::eShaderReadOnlyOptimal, 0, staged.layers);
+            continue;
+        }
+        auto copiedLevels = (uint32_t)staged.regions.size();
+        if (transferFamily)
+            setImageLayout(graphics, staged.image, staged.format, vk::ImageLayout::eTransferDstOptimal,
+                           vk::ImageLayout::eTransferSrcOptimal, 0, staged.layers, copiedLevels, srcQueueFamily,
+                           dstQueueFamily);
+        generateMips(graphics, staged.image, staged.format, staged.extent, staged.layers, copiedLevels,
+                     staged.mipLevels);
+    }
+    transfer.end();
+    if (transferFamily) graphics.end();
+
+    // renderEnd() makes the frames wait for the last value on the GPU
+    uint64_t transferValue = ++uploadValue;
+    vk::TimelineSemaphoreSubmitInfo transferTimeline({}, transferValue);
+    vk::SubmitInfo transferSubmit({}, {}, transfer, uploadSemaphore, &transferTimeline);
+    transferQueue.submit(transferSubmit);
+    if (transferFamily) {
+        uint64_t graphicsValue = ++uploadValue;
+        vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+        vk::TimelineSemaphoreSubmitInfo graphicsTimeline(transferValue, graphicsValue);
+        vk::SubmitInfo graphicsSubmit(uploadSemaphore, waitStage, graphics, uploadSemaphore, &graphicsTimeline);
+        graphicsQueue.submit(graphicsSubmit);
+    }
+
+    batch.value = uploadValue;
+    batch.stagingBegin = stagingBegin;
+    batch.stagingEnd = stagingHead;
+    batch.staging = std::move(stagingOverflow);
+    uploadBatches.push_back(std::move(batch));
+
+    stagingBegin = stagingHead;
+    stagingOverflow.clear();
+    stagedCopies.clear();
+    stagedImages.clear();
+    return uploadValue;
+}
+
+bool Vulkan::isUploadComplete(uint64_t value) { return device.getSemaphoreCounterValue(uploadSemaphore) >= value; }
+
+void Vulkan::waitUploads(uint64_t value) {
+    auto result =
+        device.waitSemaphores(vk::SemaphoreWaitInfo({}, uploadSemaphore, value), std::numeric_limits<uint64_t>::max());
+    assert(result == vk::Result::eSuccess);
+    collectUploads();
+}
+
+void Vulkan::collectUploads() {
+    if (uploadBatches.empty()) return;
+
+    auto value = device.getSemaphoreCounterValue(uploadSemaphore);
+    while (!uploadBatches.empty() && uploadBatches.front().value <= value) {
+        auto& batch = uploadBatches.front();
+        device.freeCommandBuffers(transferCommandPool, batch.transferCommands);
+        if (batch.graphicsCommands) device.freeCommandBuffers(commandPool, batch.graphicsCommands);
+        for (auto& staging : batch.staging) releaseStaging(staging);
+        uploadBatches.pop_front();
+    }
+}
+
+void Vulkan::releaseStaging(const Buffer& staging) {
+    // the pool is bounded, the buffers past it are freed
+    if (stagingPoolSize + staging.size <= STAGING_POOL_SIZE) {
+        stagingPool.push_back(staging);
+        stagingPoolSize += staging.size;
+        return;
+    }
+    vmaUnmapMemory(vmaAllocator, staging.memory);
+    vmaDestroyBuffer(vmaAllocator, staging.buffer, staging.memory);
 }
 
 Vulkan::Texture Vulkan::createTexture(vk::Extent2D extent, const void* data, uint32_t layers, bool cubemap,
                                       bool anisotropy, vk::Filter mag, vk::Filter min, vk::SamplerAddressMode modeU,
                                       vk::SamplerAddressMode modeV, vk::SamplerAddressMode modeW) {
-    Texture texture;
-    texture.format = vk::Format::eR8G8B8A8Unorm;
-
-    vk::FormatProperties formatProps = physicalDevice.getFormatProperties(texture.format);
+    auto start = std::chrono::steady_clock::now();
+    vk::Format format = vk::Format::eR8G8B8A8Unorm;
+    vk::FormatProperties formatProps = physicalDevice.getFormatProperties(format);
     uint32_t mipLevels = (uint32_t)std::log2(std::max(extent.width, extent.height)) + 1;
 
-    bool needStaging = !(formatProps.linearTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage) || (layers > 1);
-    if (needStaging) {
-        assert(formatProps.optimalTilingFeatures & vk::FormatFeatureFlagBits::eBlitSrc);
-        assert(formatProps.optimalTilingFeatures & vk::FormatFeatureFlagBits::eBlitDst);
-        assert(formatProps.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
-    } else {
-        assert(formatProps.linearTilingFeatures & vk::FormatFeatureFlagBits::eBlitSrc);
-        assert(formatProps.linearTilingFeatures & vk::FormatFeatureFlagBits::eBlitDst);
-        assert(formatProps.linearTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
-    }
+    assert(formatProps.optimalTilingFeatures & vk::FormatFeatureFlagBits::eBlitSrc);
+    assert(formatProps.optimalTilingFeatures & vk::FormatFeatureFlagBits::eBlitDst);
+    assert(formatProps.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
 
-    std::tie(texture.image, texture.memory) = createImage(
-        vmaAllocator, extent, texture.format, needStaging ? vk::ImageTiling::eOptimal : vk::ImageTiling::eLinear,
-        vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc,
-        needStaging ? vk::ImageLayout::eUndefined : vk::ImageLayout::ePreinitialized, mipLevels, layers, cubemap);
+    auto texture = createTextureImage(format, extent, mipLevels, layers, cubemap, anisotropy, mag, min, modeU, modeV,
+                                      modeW);
+    uploadTexture(texture, extent, data, layers, mipLevels);
 
-    if (needStaging)
-        std::tie(texture.stagingBuffer, texture.stagingMemory) =
-            createBuffer(vmaAllocator, extent.width * extent.height * layers * 4, vk::BufferUsageFlagBits::eTransferSrc,
-                         vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    ++textureCount;
+    textureBytes += rgbaBytes(extent, layers, mipLevels);
+    textureRgbaBytes += rgbaBytes(extent, layers, mipLevels);
+    textureTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return texture;
+}
 
-    void* textureData;
-    vmaMapMemory(vmaAllocator, needStaging ? texture.stagingMemory : texture.memory, &textureData);
-    memcpy(textureData, data, extent.width * extent.height * layers * 4);
-    vmaUnmapMemory(vmaAllocator, needStaging ? texture.stagingMemory : texture.memory);
-
-    commandBuffer.begin(vk::CommandBufferBeginInfo());
-    if (needStaging) {
-        setImageLayout(commandBuffer, texture.image, texture.format, vk::ImageLayout::eUndefined,
-                       vk::ImageLayout::eTransferDstOptimal, 0, layers);
-        vk::BufferImageCopy copyRegion(0, extent.width, extent.height, {vk::ImageAspectFlagBits::eColor, 0, 0, layers},
-                                       vk::Offset3D(0, 0, 0), vk::Extent3D(extent, 1));
-        commandBuffer.copyBufferToImage(texture.stagingBuffer, texture.image, vk::ImageLayout::eTransferDstOptimal,
-                                        copyRegion);
-        setImageLayout(commandBuffer, texture.image, texture.format, vk::ImageLayout::eTransferDstOptimal,
-                       vk::ImageLayout::eTransferSrcOptimal, 0, layers);
-    } else {
-        setImageLayout(commandBuffer, texture.image, texture.format, vk::ImageLayout::ePreinitialized,
-                       vk::ImageLayout::eTransferSrcOptimal, 0, layers);
-    }
-    for (uint32_t i = 1; i < mipLevels; ++i) {
-        vk::ImageBlit imageBlit({vk::ImageAspectFlagBits::eColor, i - 1, 0, layers},
-                                {{{}, {int32_t(extent.width >> (i - 1)), int32_t(extent.height >> (i - 1)), 1}}},
-                                {vk::ImageAspectFlagBits::eColor, i, 0, layers},
-                                {{{}, {int32_t(extent.width >> i), int32_t(extent.height >> i), 1}}});
-        setImageLayout(commandBuffer, texture.image, texture.format,
-                       needStaging ? vk::ImageLayout::eUndefined : vk::ImageLayout::ePreinitialized,
-                       vk::ImageLayout::eTransferDstOptimal, i, layers);
-        commandBuffer.blitImage(texture.image, vk::ImageLayout::eTransferSrcOptimal, texture.image,
-                                vk::ImageLayout::eTransferDstOptimal, imageBlit, vk::Filter::eLinear);
-        setImageLayout(commandBuffer, texture.image, texture.format, vk::ImageLayout::eTransferDstOptimal,
-                       vk::ImageLayout::eTransferSrcOptimal, i, layers);
+Vulkan::Texture Vulkan::createTexture(vk::Format format, vk::Extent2D extent,
+                                      const std::vector<std::vector<char>>& levels, uint32_t layers, bool cubemap,
+                                      bool anisotropy, vk::Filter mag, vk::Filter min, vk::SamplerAddressMode modeU,
+                                      vk::SamplerAddressMode modeV, vk::SamplerAddressMode modeW) {
+    auto start = std::chrono::steady_clock::now();
+    if (!isTextureFormatSupported(format))
+        throw std::runtime_error("Texture format not supported: " + vk::to_string(format));
+
+    auto mipLevels = (uint32_t)levels.size();
+    auto texture = createTextureImage(format, extent, mipLevels, layers, cubemap, anisotropy, mag, min, modeU, modeV,
+                                      modeW);
+
+    // all the levels in one staging copy, each at an offset aligned for the texel blocks
+    std::vector<char> data;
+    StagedImage staged = {{}, texture.image, format, extent, layers, mipLevels};
+    for (uint32_t i = 0; i < mipLevels; ++i) {
+        data.resize((data.size() + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1));
+        vk::Extent3D mipExtent(std::max(extent.width >> i, 1u), std::max(extent.height >> i, 1u), 1);
+        staged.regions.emplace_back(data.size(), 0, 0,
+                                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, i, 0, layers),
+                                    vk::Offset3D(0, 0, 0), mipExtent);
+        data.insert(data.end(), levels[i].begin(), levels[i].end());
     }
-    setImageLayout(commandBuffer, texture.image, texture.format, vk::ImageLayout::eTransferSrcOptimal,
-                   vk::ImageLayout::eShaderReadOnlyOptimal, 0, layers, mipLevels);
-    commandBuffer.end();
 
-    vk::Fence fence = device.createFence({});
-    graphicsQueue.submit(vk::SubmitInfo({}, {}, commandBuffer), fence);
-    device.waitForFences(fence, vk::True, std::numeric_limits<uint64_t>::max());
-    device.destroyFence(fence);
+    auto staging = stageData(data.data(), data.size());
+    staged.source = staging.first;
+    for (auto& region : staged.regions) region.bufferOffset += staging.second;
+    stagedImages.push_back(std::move(staged));
+
+    ++textureCount;
+    ++bakedTextureCount;
+    for (auto& level : levels) textureBytes += level.size();
+    textureRgbaBytes += rgbaBytes(extent, layers, mipLevels);
+    textureTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return texture;
+}
+
+bool Vulkan::isTextureFormatSupported(vk::Format format) const {
+    auto features = physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+    // the samplers filter linearly by default
+    return (features & vk::FormatFeatureFlagBits::eSampledImage) &&
+           (features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) &&
+           (features & vk::FormatFeatureFlagBits::eTransferDst);
+}
+
+Vulkan::Texture Vulkan::createTextureImage(vk::Format format, vk::Extent2D extent, uint32_t mipLevels, uint32_t layers,
+                                           bool cubemap, bool anisotropy, vk::Filter mag, vk::Filter min,
+                                           vk::SamplerAddressMode modeU, vk::SamplerAddressMode modeV,
+                                           vk::SamplerAddressMode modeW) {
+    Texture texture;
+    texture.format = format;
+
+    std::tie(texture.image, texture.memory) = createImage(
+        vmaAllocator, extent, texture.format, vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc,
+        vk::ImageLayout::eUndefined, mipLevels, layers, cubemap);
 
     vk::SamplerCreateInfo samplerCreateInfo({}, mag, min, vk::SamplerMipmapMode::eLinear, modeU, modeV, modeW, 0.0f,
                                             anisotropy, physicalDevice.getProperties().limits.maxSamplerAnisotropy,
@@ -657,23 +1228,146 @@ Vulkan::Texture Vulkan::createTexture(vk::Extent2D extent, const void* data, uin
     return texture;
 }
 
+void Vulkan::updateTexture(const Texture& texture, vk::Offset2D offset, vk::Extent2D extent, uint32_t baseLayer,
+                           uint32_t layers, const void* data) {
+    auto size = (vk::DeviceSize)extent.width * extent.height * layers * vk::blockSize(texture.format);
+    auto staging = stageData(data, size);
+    vk::BufferImageCopy copyRegion(staging.second, extent.width, extent.height,
+                                   {vk::ImageAspectFlagBits::eColor, 0, baseLayer, layers}, vk::Offset3D(offset, 0),
+                                   vk::Extent3D(extent, 1));
+    StagedImage staged = {staging.first, texture.image, texture.format, extent, baseLayer + layers, 1, {copyRegion}};
+    staged.patch = true;
+    stagedImages.push_back(std::move(staged));
+}
+
+void Vulkan::uploadTexture(const Texture& texture, vk::Extent2D extent, const void* data, uint32_t layers,
+                           uint32_t mipLevels) {
+    // copied and blitted with the next batch of uploads
+    auto staging = stageData(data, (vk::DeviceSize)extent.width * extent.height * layers * 4);
+    vk::BufferImageCopy copyRegion(staging.second, extent.width, extent.height,
+                                   {vk::ImageAspectFlagBits::eColor, 0, 0, layers}, vk::Offset3D(0, 0, 0),
+                                   vk::Extent3D(extent, 1));
+    stagedImages.push_back({staging.first, texture.image, texture.format, extent, layers, mipLevels, {copyRegion}});
+}
+
 void Vulkan::destroyTexture(const Texture& texture) {
+    unstageImage(texture.image);
     device.destroy(texture.view);
     device.destroySampler(texture.sampler);
-    vmaDestroyBuffer(vmaAllocator, texture.stagingBuffer, texture.stagingMemory);
     vmaDestroyImage(vmaAllocator, texture.image, texture.memory);
 }
 
 vk::ShaderModule Vulkan::createShaderModule(vk::ShaderStageFlagBits shaderStage, const std::string& shaderText) {
+    auto start = std::chrono::steady_clock::now();
+    bool cached;
+    auto shaderSPV = loadSPV(shaderStage, shaderText, cached);
+    shaderTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++shaderCount;
+    if (cached) ++shaderCacheHits;
+
+    return createShaderModule(shaderSPV);
+}
+
+vk::ShaderModule Vulkan::createShaderModule(const std::vector<unsigned int>& shaderSPV) {
+    auto shaderModule = device.createShaderModule({{}, shaderSPV});
+    shaderHashes[static_cast<VkShaderModule>(shaderModule)] = hashSPV(shaderSPV);
+    return shaderModule;
+}
+
+void Vulkan::requestShaderModule(vk::ShaderStageFlagBits shaderStage, const std::string& shaderText,
+                                 vk::ShaderModule& shaderModule, const std::string& name) {
+    shaderRequests.push_back({shaderStage, shaderText, &shaderModule, name});
+}
+
+void Vulkan::resolveShaderModules() {
+    auto start = std::chrono::steady_clock::now();
+
+    // the same source is only compiled once
+    std::vector<size_t> sources;  // the first request of each source
+    std::vector<size_t> sourceOf(shaderRequests.size());
+    std::map<std::pair<vk::ShaderStageFlagBits, std::string>, size_t> sourceIndices;
+    for (size_t i = 0; i < shaderRequests.size(); ++i) {
+        auto key = std::make_pair(shaderRequests[i].stage, shaderRequests[i].text);
+        auto it = sourceIndices.emplace(std::move(key), sources.size());
+        if (it.second) sources.push_back(i);
+        sourceOf[i] = it.first->second;
+    }
+
+    std::vector<std::vector<unsigned int>> shaderSPVs(sources.size());
+    std::vector<std::string> errors(sources.size());
+    std::vector<float> times(sources.size());
+    std::vector<char> cached(sources.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)sources.size(); ++i) {
+        auto compileStart = std::chrono::steady_clock::now();
+        auto& request = shaderRequests[sources[i]];
+        try {
+            bool hit;
+            shaderSPVs[i] = loadSPV(request.stage, request.text, hit);
+            cached[i] = hit;
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        }
+        times[i] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - compileStart).count();
+    }
+
+    auto requests = std::move(shaderRequests);
+    shaderRequests.clear();
+    for (size_t i = 0; i < sources.size(); ++i) {
+        auto& name = requests[sources[i]].name;
+        if (!errors[i].empty()) {
+            std::cerr << "When compiling file: " + name + "\n";
+            throw std::runtime_error(errors[i]);
+        }
+        std::cout << name << ": " << times[i] << " ms" << (cached[i] ? " from the shader cache" : "") << '\n';
+        shaderCacheHits += cached[i];
+    }
+    for (size_t i = 0; i < requests.size(); ++i) *requests[i].module = createShaderModule(shaderSPVs[sourceOf[i]]);
+
+    shaderCount += (uint32_t)sources.size();
+    shaderTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<unsigned int> Vulkan::loadSPV(vk::ShaderStageFlagBits shaderStage, const std::string& shaderText,
+                                          bool& cached) const {
+    std::string cacheFile;
+    if (!shaderCacheDir.empty()) {
+        std::set<std::string> included;
+        std::string sources = shaderText;
+        appendIncludes(shaderText, GLSL_INCLUDE_DIRECTORY, included, sources);
+
+        StateKey key;
+        key.bytes = GLSL_PREAMBLE + sources;
+        key.add(shaderStage).add(GLSL_DEFAULT_VERSION).add(GLSL_MESSAGES).add(SPV_CACHE_VERSION);
+        // another compiler may generate other code from the same sources
+        auto compiler = glslang::GetVersion();
+        key.add(compiler.major).add(compiler.minor).add(compiler.patch);
+        key.bytes += compiler.flavor ? compiler.flavor : "";
+
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)hashBytes(key.bytes.data(), key.bytes.size()));
+        cacheFile = shaderCacheDir + "/" + name + ".spv";
+    }
+
     std::vector<unsigned int> shaderSPV;
+    cached = !cacheFile.empty() && readSPV(cacheFile, shaderSPV);
+    if (cached) return shaderSPV;
+
     if (!GLSLtoSPV(shaderStage, shaderText, shaderSPV)) {
         throw std::runtime_error("Could not covert glsl shader to SPIRV");
     }
-
-    return device.createShaderModule({{}, shaderSPV});
+    if (!cacheFile.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(shaderCacheDir, error);
+        writeSPV(cacheFile, shaderSPV);
+    }
+    return shaderSPV;
 }
 
-void Vulkan::destroyShaderModule(const vk::ShaderModule& shader) { device.destroyShaderModule(shader); }
+void Vulkan::destroyShaderModule(const vk::ShaderModule& shader) {
+    shaderHashes.erase(static_cast<VkShaderModule>(shader));
+    device.destroyShaderModule(shader);
+}
 
 void Vulkan::initInstance() {
     static vk::DynamicLoader dl;
@@ -681,7 +1375,7 @@ void Vulkan::initInstance() {
         dl.template getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
     VULKAN_HPP_DEFAULT_DISPATCHER.init(getInstanceProcAddr);
 
-    if (!applicationInfo.apiVersion) applicationInfo.apiVersion = VK_API_VERSION_1_1;
+    if (!applicationInfo.apiVersion) applicationInfo.apiVersion = VK_API_VERSION_1_2;
     instanceCreateInfo.setPApplicationInfo(&applicationInfo);
     instance = vk::createInstance(instanceCreateInfo);
     VULKAN_HPP_DEFAULT_DISPATCHER.init(instance);
@@ -725,33 +1419,48 @@ void Vulkan::initDevice(std::function<vk::SurfaceKHR(const vk::Instance&)> getSu
     if (presentationQueueFamliyIndex >= queueFamilyProperties.size())
         throw std::runtime_error("Cannot get presentation queue!");
 
-    float queuePriority = 0.0f;
-    vk::DeviceQueueCreateInfo deviceQueueCreateInfos[2];
-    deviceQueueCreateInfos[0].setQueueCount(1);
-    deviceQueueCreateInfos[0].setQueueFamilyIndex(graphicsQueueFamliyIndex);
-    deviceQueueCreateInfos[0].setPQueuePriorities(&queuePriority);
-    if (graphicsQueueFamliyIndex == presentationQueueFamliyIndex) {
-        deviceCreateInfo.setQueueCreateInfos(deviceQueueCreateInfos[0]);
-    } else {
-        deviceQueueCreateInfos[1].setQueueCount(1);
-        deviceQueueCreateInfos[1].setQueueFamilyIndex(presentationQueueFamliyIndex);
-        deviceQueueCreateInfos[1].setPQueuePriorities(&queuePriority);
-        deviceCreateInfo.setQueueCreateInfos(deviceQueueCreateInfos);
+    // the uploads go to a queue doing nothing else, copying while the graphics queue draws
+    transferQueueFamilyIndex = graphicsQueueFamliyIndex;
+    for (uint32_t i = 0; i < queueFamilyProperties.size(); ++i) {
+        auto flags = queueFamilyProperties[i].queueFlags;
+        if ((flags & vk::QueueFlagBits::eTransfer) &&
+            !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+            transferQueueFamilyIndex = i;
+            break;
+        }
     }
 
+    float queuePriority = 0.0f;
+    std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos;
+    for (auto index : std::set<uint32_t>{graphicsQueueFamliyIndex, presentationQueueFamliyIndex,
+                                         transferQueueFamilyIndex})
+        deviceQueueCreateInfos.emplace_back(vk::DeviceQueueCreateFlags(), index, 1, &queuePriority);
+    deviceCreateInfo.setQueueCreateInfos(deviceQueueCreateInfos);
+
+    // the uploads signal a timeline semaphore, core since 1.2
+    uint32_t apiVersion = std::min(applicationInfo.apiVersion, physicalDevice.getProperties().apiVersion);
+    if (apiVersion < VK_API_VERSION_1_2) deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
     deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     deviceCreateInfo.setPEnabledExtensionNames(deviceExtensions);
 
     deviceFeatures.samplerAnisotropy = vk::True;
     deviceFeatures.imageCubeArray = vk::True;
+    // for the textures baked offline, when there is no support they are loaded from their source images
+    deviceFeatures.textureCompressionBC = physicalDevice.getFeatures().textureCompressionBC;
     deviceCreateInfo.setPEnabledFeatures(&deviceFeatures);
 
+    vk::PhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures(vk::True);
+    timelineSemaphoreFeatures.setPNext(const_cast<void*>(deviceCreateInfo.pNext));
+    deviceCreateInfo.setPNext(&timelineSemaphoreFeatures);
+
     device = physicalDevice.createDevice(deviceCreateInfo);
     VULKAN_HPP_DEFAULT_DISPATCHER.init(device);
+    deviceCreateInfo.setPNext(timelineSemaphoreFeatures.pNext);
 
     graphicsQueue = device.getQueue(graphicsQueueFamliyIndex, 0);
     presentationQueue = device.getQueue(presentationQueueFamliyIndex, 0);
     computeQueue = graphicsQueue;
+    transferQueue = device.getQueue(transferQueueFamilyIndex, 0);
 
     VmaVulkanFunctions vulkanFunctions = {};
     vulkanFunctions.vkGetInstanceProcAddr = VULKAN_HPP_DEFAULT_DISPATCHER.vkGetInstanceProcAddr;
@@ -764,14 +1473,70 @@ void Vulkan::initDevice(std::function<vk::SurfaceKHR(const vk::Instance&)> getSu
     allocatorCreateInfo.pVulkanFunctions = &vulkanFunctions;
 
     vmaCreateAllocator(&allocatorCreateInfo, &vmaAllocator);
+
+    auto limits = physicalDevice.getProperties().limits;
+    uniformAlignment = limits.minUniformBufferOffsetAlignment;
+    maxDynamicUniforms = limits.maxDescriptorSetUniformBuffersDynamic;
 }
 
 void Vulkan::initCommandBuffer() {
     commandPool =
         device.createCommandPool({vk::CommandPoolCreateFlagBits::eResetCommandBuffer, graphicsQueueFamliyIndex});
 
-    vk::CommandBufferAllocateInfo commandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1);
-    device.allocateCommandBuffers(&commandBufferAllocateInfo, &commandBuffer);
+    // the uploads record a command buffer of their own per batch
+    transferCommandPool =
+        device.createCommandPool({vk::CommandPoolCreateFlagBits::eTransient, transferQueueFamilyIndex});
+
+    vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo(vk::SemaphoreType::eTimeline, uploadValue);
+    uploadSemaphore = device.createSemaphore(vk::SemaphoreCreateInfo({}, &semaphoreTypeCreateInfo));
+}
+
+void Vulkan::initRecorders() {
+    // never reallocated, the workers keep pointers to theirs
+    recorders.resize(1 + std::max(omp_get_max_threads(), 1));
+    for (auto& recorder : recorders)
+        for (auto& commandPool : recorder.commandPools)
+            commandPool =
+                device.createCommandPool({vk::CommandPoolCreateFlagBits::eTransient, graphicsQueueFamliyIndex});
+}
+
+void Vulkan::initPipelineCache() {
+    std::vector<char> data;
+    if (!pipelineCacheFile.empty()) {
+        std::ifstream file(pipelineCacheFile, std::ios::binary | std::ios::ate);
+        auto fileSize = (uint64_t)std::max<std::streamoff>(file.tellg(), 0);
+        file.seekg(0);
+        PipelineCacheHeader header = {};
+        if (file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            // a cache of another device or driver is not an error, we start cold, and neither is a truncated one
+            auto expected = makePipelineCacheHeader(physicalDevice.getProperties(), header.dataSize);
+            if (!memcmp(&header, &expected, sizeof(header)) && header.dataSize == fileSize - sizeof(header)) {
+                data.resize(header.dataSize);
+                if (!file.read(data.data(), data.size())) data.clear();
+            }
+        }
+    }
+
+    pipelineCache = device.createPipelineCache({{}, data.size(), data.data()});
+    pipelineCacheLoaded = !data.empty();
+}
+
+void Vulkan::savePipelineCache() {
+    if (pipelineCacheFile.empty()) return;
+
+    auto data = device.getPipelineCacheData(pipelineCache);
+    auto header = makePipelineCacheHeader(physicalDevice.getProperties(), data.size());
+
+    // written aside and renamed, so a crash never leaves half a cache behind
+    auto tempFile = pipelineCacheFile + ".tmp";
+    {
+        std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file) return;
+    }
+    std::remove(pipelineCacheFile.c_str());
+    std::rename(tempFile.c_str(), pipelineCacheFile.c_str());
 }
 
 void Vulkan::initSwapChain(vk::Extent2D extent) {
@@ -833,62 +1598,98 @@ void Vulkan::initSwapChain(vk::Extent2D extent) {
 void Vulkan::initDescriptorSet(const std::map<int, Buffer>& uniforms, const std::map<int, Texture>& textures) {
     assert(!uniforms.empty() || !textures.empty());
 
-    std::array<vk::DescriptorPoolSize, 2> poolSizes;
-    poolSizes[0] = {vk::DescriptorType::eUniformBuffer, (uint32_t)uniforms.size()};
-    poolSizes[1] = {vk::DescriptorType::eCombinedImageSampler, (uint32_t)textures.size()};
-    descriptorPool() = device.createDescriptorPool({{},
-                                                    1,
-                                                    poolSizes[0].descriptorCount == 0   ? 1u
-                                                    : poolSizes[1].descriptorCount == 0 ? 1u
-                                                                                        : 2u,
-                                                    poolSizes[0].descriptorCount == 0   ? &poolSizes[1]
-                                                    : poolSizes[1].descriptorCount == 0 ? &poolSizes[0]
-                                                                                        : poolSizes.data()});
-
     std::vector<vk::DescriptorSetLayoutBinding> descriptorSetLayoutBindings;
     descriptorSetLayoutBindings.reserve(uniforms.size() + textures.size());
-    for (auto uniform : uniforms)
-        descriptorSetLayoutBindings.emplace_back(uniform.first, vk::DescriptorType::eUniformBuffer, 1,
-                                                 uniform.second.stage);
+    auto& uniformSlots = drawResources.back().uniformSlots;
+    for (auto uniform : uniforms) {
+        bool dynamic = uniform.second.block != -1;
+        descriptorSetLayoutBindings.emplace_back(
+            uniform.first, dynamic ? vk::DescriptorType::eUniformBufferDynamic : vk::DescriptorType::eUniformBuffer,
+            1, uniform.second.stage);
+        if (dynamic) uniformSlots.push_back(uniformChunks[uniformBlocks[uniform.second.block].chunk].slotSize);
+    }
+    if (uniformSlots.size() + (globalSet ? 1 : 0) > maxDynamicUniforms)
+        throw std::runtime_error("too many uniform buffers in a descriptor set!");
     for (auto texture : textures)
         descriptorSetLayoutBindings.emplace_back(texture.first, vk::DescriptorType::eCombinedImageSampler, 1,
                                                  texture.second.stage);
-    descriptorSetLayout() = device.createDescriptorSetLayout({{}, descriptorSetLayoutBindings});
 
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo(descriptorPool(), 1, &descriptorSetLayout());
-    device.allocateDescriptorSets(&descriptorSetAllocateInfo, &descriptorSet());
-
-    std::vector<vk::DescriptorBufferInfo> descriptorBufferInfo;
-    descriptorBufferInfo.reserve(uniforms.size());
-    std::vector<vk::DescriptorImageInfo> descriptorImageInfo;
-    descriptorImageInfo.reserve(textures.size());
-    std::vector<vk::WriteDescriptorSet> writeDescriptorSet;
-    writeDescriptorSet.reserve(uniforms.size() + textures.size());
-
-    for (const auto& uniform : uniforms) {
-        descriptorBufferInfo.emplace_back(uniform.second.buffer, 0, uniform.second.size);
-        writeDescriptorSet.emplace_back(descriptorSet(), uniform.first, 0, 1, vk::DescriptorType::eUniformBuffer,
-                                        nullptr, &descriptorBufferInfo.back());
+    StateKey bindingsKey;
+    for (auto& binding : descriptorSetLayoutBindings)
+        bindingsKey.add(binding.binding).add(binding.descriptorType).add(binding.descriptorCount).add(
+            binding.stageFlags);
+    drawResources.back().bindingsKey = bindingsKey.bytes;
+
+    auto& descriptorLayout = descriptorLayouts[bindingsKey.bytes];
+    if (!descriptorLayout.setLayout) {
+        descriptorLayout.setLayout = device.createDescriptorSetLayout({{}, descriptorSetLayoutBindings});
+
+        std::vector<vk::DescriptorUpdateTemplateEntry> descriptorUpdateTemplateEntries;
+        descriptorUpdateTemplateEntries.reserve(descriptorSetLayoutBindings.size());
+        for (size_t i = 0; i < descriptorSetLayoutBindings.size(); ++i)
+            descriptorUpdateTemplateEntries.emplace_back(descriptorSetLayoutBindings[i].binding, 0, 1,
+                                                         descriptorSetLayoutBindings[i].descriptorType,
+                                                         i * sizeof(DescriptorInfo), sizeof(DescriptorInfo));
+        descriptorLayout.updateTemplate = device.createDescriptorUpdateTemplate(
+            {{}, descriptorUpdateTemplateEntries, vk::DescriptorUpdateTemplateType::eDescriptorSet,
+             descriptorLayout.setLayout});
     }
-    for (const auto& texture : textures) {
-        descriptorImageInfo.emplace_back(texture.second.sampler, texture.second.view,
-                                         isDepthFormat(texture.second.format)
-                                             ? vk::ImageLayout::eDepthStencilReadOnlyOptimal
-                                             : vk::ImageLayout::eShaderReadOnlyOptimal);
-        writeDescriptorSet.emplace_back(descriptorSet(), texture.first, 0, 1, vk::DescriptorType::eCombinedImageSampler,
-                                        &descriptorImageInfo.back());
+    descriptorSetLayout() = descriptorLayout.setLayout;
+    descriptorSet() = allocateDescriptorSet(descriptorLayout.setLayout);
+
+    // in the order of the bindings
+    std::vector<DescriptorInfo> descriptorInfos(descriptorSetLayoutBindings.size());
+    auto descriptorInfo = descriptorInfos.begin();
+    // the dynamic ones at the offset of their block in the first slot
+    for (const auto& uniform : uniforms)
+        (descriptorInfo++)->buffer = vk::DescriptorBufferInfo(
+            uniform.second.buffer, uniform.second.block != -1 ? uniformBlocks[uniform.second.block].offset : 0,
+            uniform.second.size);
+    for (const auto& texture : textures)
+        (descriptorInfo++)->image = vk::DescriptorImageInfo(texture.second.sampler, texture.second.view,
+                                                            isDepthFormat(texture.second.format)
+                                                                ? vk::ImageLayout::eDepthStencilReadOnlyOptimal
+                                                                : vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    device.updateDescriptorSetWithTemplate(descriptorSet(), descriptorLayout.updateTemplate, descriptorInfos.data());
+}
+
+vk::DescriptorSet Vulkan::allocateDescriptorSet(const vk::DescriptorSetLayout& setLayout) {
+    vk::DescriptorSet descriptorSet;
+    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo({}, 1, &setLayout);
+    if (!descriptorPools.empty()) {
+        descriptorSetAllocateInfo.descriptorPool = descriptorPools.back();
+        if (device.allocateDescriptorSets(&descriptorSetAllocateInfo, &descriptorSet) == vk::Result::eSuccess)
+            return descriptorSet;
     }
 
-    device.updateDescriptorSets(writeDescriptorSet, nullptr);
+    // sets are never freed on their own, a full pool stays until the end
+    for (;;) {
+        descriptorPoolSets = descriptorPoolSets ? 2 * descriptorPoolSets : DESCRIPTOR_POOL_SETS;
+        std::array<vk::DescriptorPoolSize, 3> poolSizes = {
+            vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, descriptorPoolSets * DESCRIPTORS_PER_SET),
+            vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic,
+                                   descriptorPoolSets * DESCRIPTORS_PER_SET),
+            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler,
+                                   descriptorPoolSets * DESCRIPTORS_PER_SET)};
+        descriptorPools.push_back(device.createDescriptorPool({{}, descriptorPoolSets, poolSizes}));
+
+        descriptorSetAllocateInfo.descriptorPool = descriptorPools.back();
+        auto result = device.allocateDescriptorSets(&descriptorSetAllocateInfo, &descriptorSet);
+        if (result == vk::Result::eSuccess) return descriptorSet;
+        // a set larger than a whole pool tries the next one
+        if (result != vk::Result::eErrorOutOfPoolMemory && result != vk::Result::eErrorFragmentedPool)
+            throw std::runtime_error("failed to allocate descriptor set!");
+    }
 }
 
 void Vulkan::initFrameBuffers() {
     renderPassBuilder().buildImages(*this);
     renderPassBuilder().buildDescriptorSets(device, swapChainImages.size());
 
+    auto extent = renderExtent();
     std::vector<vk::ImageView> attachments(renderPassBuilder().attachmentDescriptions.size());
-    vk::FramebufferCreateInfo framebufferCreateInfo({}, renderPass(), attachments, imageExtent.width,
-                                                    imageExtent.height, 1);
+    vk::FramebufferCreateInfo framebufferCreateInfo({}, renderPass(), attachments, extent.width, extent.height, 1);
 
     framebuffers().reserve(swapChainImageViews.size());
     for (unsigned j = 0; j < swapChainImageViews.size(); ++j) {
@@ -910,7 +1711,7 @@ void Vulkan::initFrameBuffers() {
 
 uint32_t Vulkan::initPipeline(const vk::ShaderModule& vertexShaderModule, const vk::ShaderModule& fragmentShaderModule,
                               uint32_t vertexStride, const std::vector<vk::Format>& vertexFormats, uint32_t subpass,
-                              vk::CullModeFlags cullMode) {
+                              vk::CullModeFlags cullMode, bool blendEnable, uint32_t pushConstantSize) {
     vk::VertexInputBindingDescription vertexInputBindingDescription(0, vertexStride);
 
     std::vector<vk::VertexInputAttributeDescription> vertexInputAtrributeDescriptions;
@@ -924,12 +1725,16 @@ uint32_t Vulkan::initPipeline(const vk::ShaderModule& vertexShaderModule, const
 
     return initPipeline(vertexShaderModule, fragmentShaderModule,
                         {{}, vertexInputBindingDescription, vertexInputAtrributeDescriptions},
-                        vk::PrimitiveTopology::eTriangleList, subpass, cullMode);
+                        vk::PrimitiveTopology::eTriangleList, subpass, cullMode,
+                        pushConstantSize ? vk::PushConstantRange(PUSH_CONSTANT_STAGES, 0, pushConstantSize)
+                                         : vk::PushConstantRange(),
+                        blendEnable);
 }
 
 uint32_t Vulkan::initPipeline(const vk::ShaderModule& vertexShaderModule, const vk::ShaderModule& fragmentShaderModule,
                               const std::vector<uint32_t>& vertexStrides, const std::vector<vk::Format>& vertexFormats,
-                              vk::PrimitiveTopology primitiveTopology, uint32_t subpass, vk::CullModeFlags cullMode) {
+                              vk::PrimitiveTopology primitiveTopology, uint32_t subpass, vk::CullModeFlags cullMode,
+                              uint32_t pushConstantSize) {
     std::vector<vk::VertexInputBindingDescription> vertexInputBindingDescriptions;
     vertexInputBindingDescriptions.reserve(vertexStrides.size());
     for (int i = 0; i < vertexStrides.size(); ++i) vertexInputBindingDescriptions.emplace_back(i, vertexStrides[i]);
@@ -939,16 +1744,19 @@ uint32_t Vulkan::initPipeline(const vk::ShaderModule& vertexShaderModule, const
     for (uint32_t i = 0; i < vertexFormats.size(); ++i)
         vertexInputAtrributeDescriptions.emplace_back(i, i, vertexFormats[i], 0);
 
-    assert(4 <= physicalDevice.getProperties().limits.maxPushConstantsSize);
+    // the draw id, when it has no block of its own
     return initPipeline(vertexShaderModule, fragmentShaderModule,
                         {{}, vertexInputBindingDescriptions, vertexInputAtrributeDescriptions}, primitiveTopology,
-                        subpass, cullMode, {vk::ShaderStageFlagBits::eAll, 0, 4});
+                        subpass, cullMode,
+                        pushConstantSize ? vk::PushConstantRange(PUSH_CONSTANT_STAGES, 0, pushConstantSize)
+                                         : vk::PushConstantRange(vk::ShaderStageFlagBits::eAll, 0, 4));
 }
 
 uint32_t Vulkan::initPipeline(const vk::ShaderModule& vertexShaderModule, const vk::ShaderModule& fragmentShaderModule,
                               const vk::PipelineVertexInputStateCreateInfo& vertexInfo,
                               vk::PrimitiveTopology primitiveTopology, uint32_t subpass, vk::CullModeFlags cullMode,
-                              const vk::PushConstantRange& pushConstant) {
+                              const vk::PushConstantRange& pushConstant, bool blendEnable) {
+    assert(pushConstant.size <= physicalDevice.getProperties().limits.maxPushConstantsSize);
     std::array<vk::PipelineShaderStageCreateInfo, 2> pipelineShaderStageCreateInfos = {
         vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertexShaderModule, "main"),
         vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, fragmentShaderModule, "main")};
@@ -970,8 +1778,8 @@ uint32_t Vulkan::initPipeline(const vk::ShaderModule& vertexShaderModule, const
 
     std::vector<vk::PipelineColorBlendAttachmentState> pipelineColorBlendAttachmentStates(
         renderPassBuilder().subpassDescriptions[subpass].colorAttachmentCount,
-        {true, vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd, vk::BlendFactor::eOne,
-         vk::BlendFactor::eZero, vk::BlendOp::eAdd,
+        {blendEnable, vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd,
+         vk::BlendFactor::eOne, vk::BlendFactor::eZero, vk::BlendOp::eAdd,
          vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB |
              vk::ColorComponentFlagBits::eA});
     vk::PipelineColorBlendStateCreateInfo pipelineColorBlendStateCreateInfo({}, false, vk::LogicOp::eNoOp,
@@ -980,34 +1788,74 @@ uint32_t Vulkan::initPipeline(const vk::ShaderModule& vertexShaderModule, const
     std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
     vk::PipelineDynamicStateCreateInfo pipelineDynamicStateCreateInfo({}, dynamicStates);
 
-    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
-    descriptorSetLayouts.reserve(2);
-
-    if (descriptorSetLayout()) descriptorSetLayouts.push_back(descriptorSetLayout());
-    if (renderPassBuilder().descriptorSetLayout)
-        descriptorSetLayouts.push_back(renderPassBuilder().descriptorSetLayout);
+    // a set layout with the same bindings is compatible with those of the other draws
+    StateKey layoutKey;
+    layoutKey.bytes = drawResources.back().bindingsKey;
+    layoutKey.add(static_cast<VkDescriptorSetLayout>(renderPassBuilder().descriptorSetLayout))
+        .add(static_cast<VkDescriptorSetLayout>(globalSetLayout))
+        .add(pushConstant);
+
+    auto& sharedLayout = pipelineLayouts[layoutKey.bytes];
+    if (!sharedLayout) {
+        // the sets keep their numbers, the missing ones before the last get an empty layout
+        std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = {descriptorSetLayout(),
+                                                                     renderPassBuilder().descriptorSetLayout};
+        if (globalSetLayout) descriptorSetLayouts.push_back(globalSetLayout);
+        while (!descriptorSetLayouts.empty() && !descriptorSetLayouts.back()) descriptorSetLayouts.pop_back();
+        for (auto& setLayout : descriptorSetLayouts) {
+            if (setLayout) continue;
+            if (!emptySetLayout) emptySetLayout = device.createDescriptorSetLayout({});
+            setLayout = emptySetLayout;
+        }
 
-    pipelineLayout() = device.createPipelineLayout({{},
+        sharedLayout = device.createPipelineLayout({{},
                                                     (uint32_t)descriptorSetLayouts.size(),
                                                     descriptorSetLayouts.data(),
                                                     pushConstant.size ? 1u : 0,
                                                     pushConstant.size ? &pushConstant : nullptr});
-
-    vk::GraphicsPipelineCreateInfo graphicPipelineCreateInfo(
-        {}, pipelineShaderStageCreateInfos, &vertexInfo, &pipelineInputAssemblyStateCreateInfo, nullptr,
-        &pipelineViewportStateCreateInfo, &pipelineRasterizationStateCreateInfo, &pipelineMultisampleStateCreateInfo,
-        &pipelineDepthStencilStateCreateInfo, &pipelineColorBlendStateCreateInfo, &pipelineDynamicStateCreateInfo,
-        pipelineLayout(), renderPass(), subpass);
-
-    vk::Result result;
-    std::tie(result, graphicsPipeline()) = device.createGraphicsPipeline(nullptr, graphicPipelineCreateInfo);
-    assert(result == vk::Result::eSuccess);
+    }
+    pipelineLayout() = sharedLayout;
+
+    // everything else the pipeline is created from is fixed, or follows the render pass
+    StateKey pipelineKey;
+    auto vertexHash = shaderHashes.find(static_cast<VkShaderModule>(vertexShaderModule));
+    auto fragmentHash = shaderHashes.find(static_cast<VkShaderModule>(fragmentShaderModule));
+    if (vertexHash != shaderHashes.end() && fragmentHash != shaderHashes.end())
+        pipelineKey.add(vertexHash->second).add(fragmentHash->second);
+    else  // not created by us, never shared
+        pipelineKey.add(~uint64_t(0)).add(drawResources.size());
+    pipelineKey.add(vertexInfo.vertexBindingDescriptionCount).add(vertexInfo.vertexAttributeDescriptionCount);
+    for (uint32_t i = 0; i < vertexInfo.vertexBindingDescriptionCount; ++i)
+        pipelineKey.add(vertexInfo.pVertexBindingDescriptions[i]);
+    for (uint32_t i = 0; i < vertexInfo.vertexAttributeDescriptionCount; ++i)
+        pipelineKey.add(vertexInfo.pVertexAttributeDescriptions[i]);
+    pipelineKey.add(primitiveTopology).add(cullMode).add(blendEnable).add(subpass);
+    pipelineKey.add(static_cast<VkRenderPass>(renderPass())).add(static_cast<VkPipelineLayout>(sharedLayout));
+
+    auto& sharedPipeline = pipelines[pipelineKey.bytes];
+    if (!sharedPipeline) {
+        vk::GraphicsPipelineCreateInfo graphicPipelineCreateInfo(
+            {}, pipelineShaderStageCreateInfos, &vertexInfo, &pipelineInputAssemblyStateCreateInfo, nullptr,
+            &pipelineViewportStateCreateInfo, &pipelineRasterizationStateCreateInfo,
+            &pipelineMultisampleStateCreateInfo, &pipelineDepthStencilStateCreateInfo,
+            &pipelineColorBlendStateCreateInfo, &pipelineDynamicStateCreateInfo, sharedLayout, renderPass(), subpass);
+
+        auto start = std::chrono::steady_clock::now();
+        vk::Result result;
+        std::tie(result, sharedPipeline) = device.createGraphicsPipeline(pipelineCache, graphicPipelineCreateInfo);
+        assert(result == vk::Result::eSuccess);
+        pipelineTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ++pipelineCount;
+    }
+    graphicsPipeline() = sharedPipeline;
 
     return (uint32_t)drawResources.size() - 1;
 }
 
-void Vulkan::destroySwapChain() {
+void Vulkan::destroySwapChain(bool keepFixedPasses) {
     for (auto& renderResource : renderResources) {
+        if (keepFixedPasses && renderResource.renderPassBuilder.extent.width) continue;
+
         for (auto const& framebuffer : renderResource.framebuffers) device.destroyFramebuffer(framebuffer);
         renderResource.framebuffers.clear();
         renderResource.renderPassBuilder.destroyImages(device, vmaAllocator);
@@ -1047,6 +1895,8 @@ Vulkan::RenderPassBuilder& Vulkan::RenderPassBuilder::dependOn(uint32_t subpass)
 }
 
 void Vulkan::RenderPassBuilder::buildImages(Vulkan& vulkan) {
+    auto extent = this->extent.width ? this->extent : vulkan.imageExtent;
+
     images.reserve(vulkan.swapChainImages.size());
     imageViews.reserve(vulkan.swapChainImages.size());
 
@@ -1075,8 +1925,7 @@ void Vulkan::RenderPassBuilder::buildImages(Vulkan& vulkan) {
                 throw std::runtime_error("ColorAttachment format not supported.");
             }
 
-            auto image = createImage(vulkan.vmaAllocator, vulkan.imageExtent, attachmentDescriptions[i].format, tiling,
-                                     colorUsage);
+            auto image = createImage(vulkan.vmaAllocator, extent, attachmentDescriptions[i].format, tiling, colorUsage);
             vk::ImageView imageView = vulkan.device.createImageView({{},
                                                                      image.first,
                                                                      vk::ImageViewType::e2D,
@@ -1101,7 +1950,7 @@ void Vulkan::RenderPassBuilder::buildImages(Vulkan& vulkan) {
             }
 
             auto image =
-                createImage(vulkan.vmaAllocator, vulkan.imageExtent, attachmentDescriptions.back().format, tiling,
+                createImage(vulkan.vmaAllocator, extent, attachmentDescriptions.back().format, tiling,
                             vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment |
                                 vk::ImageUsageFlagBits::eTransientAttachment);
             vk::ImageView imageView = vulkan.device.createImageView({{},
@@ -1125,8 +1974,8 @@ void Vulkan::RenderPassBuilder::buildImages(Vulkan& vulkan) {
                 throw std::runtime_error("ColorAttachment format not supported.");
             }
 
-            auto image = createImage(vulkan.vmaAllocator, vulkan.imageExtent, attachmentDescriptions.back().format,
-                                     tiling, colorUsage);
+            auto image =
+                createImage(vulkan.vmaAllocator, extent, attachmentDescriptions.back().format, tiling, colorUsage);
             vk::ImageView imageView = vulkan.device.createImageView({{},
                                                                      image.first,
                                                                      vk::ImageViewType::e2D,
@@ -1154,7 +2003,7 @@ void Vulkan::RenderPassBuilder::buildImages(Vulkan& vulkan) {
         auto offscreenColorTexture = std::make_shared<Texture>();
         offscreenColorTexture->format = attachmentDescriptions.front().format;
         std::tie(offscreenColorTexture->image, offscreenColorTexture->memory) =
-            createImage(vulkan.vmaAllocator, vulkan.imageExtent, offscreenColorTexture->format, tiling,
+            createImage(vulkan.vmaAllocator, extent, offscreenColorTexture->format, tiling,
                         vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled);
         offscreenColorTexture->view = vulkan.device.createImageView({{},
                                                                      offscreenColorTexture->image,
@@ -1196,7 +2045,7 @@ void Vulkan::RenderPassBuilder::buildImages(Vulkan& vulkan) {
         offscreenDepthTexture = std::make_shared<Texture>();
         offscreenDepthTexture->format = attachmentDescriptions.back().format;
         std::tie(offscreenDepthTexture->image, offscreenDepthTexture->memory) =
-            createImage(vulkan.vmaAllocator, vulkan.imageExtent, offscreenDepthTexture->format, tiling,
+            createImage(vulkan.vmaAllocator, extent, offscreenDepthTexture->format, tiling,
                         vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled);
         offscreenDepthTexture->view = vulkan.device.createImageView({{},
                                                                      offscreenDepthTexture->image,
@@ -1347,8 +2196,10 @@ Vulkan::RenderPassBuilder Vulkan::makeRenderPassBuilder(const vk::ArrayProxy<vk:
         builder.attachmentDescriptions.back().setInitialLayout(vk::ImageLayout::eUndefined);
         builder.attachmentDescriptions.back().setFinalLayout(finalLayout);
         if (offscreenDepth) builder.attachmentDescriptions.back().setStoreOp(vk::AttachmentStoreOp::eStore);
+        // written in the pass, the final layout is only for the passes sampling it
         builder.depthReference = std::make_shared<vk::AttachmentReference>(
-            static_cast<uint32_t>(builder.attachmentDescriptions.size() - 1), finalLayout);
+            static_cast<uint32_t>(builder.attachmentDescriptions.size() - 1),
+            vk::ImageLayout::eDepthStencilAttachmentOptimal);
         return builder;
     }
 
@@ -10,7 +10,9 @@
 #define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
 #include <vk_mem_alloc.h>
 
+#include <deque>
 #include <functional>
+#include <unordered_map>
 
 class Vulkan {
    public:
@@ -24,6 +26,7 @@ class Vulkan {
         size_t size = 0;
         uint32_t stride = 0;
         vk::ShaderStageFlags stage = vk::ShaderStageFlagBits::eVertex;
+        uint32_t block = -1;  // of the uniform ring, for a uniform buffer
     };
 
     struct Texture {
@@ -33,8 +36,6 @@ class Vulkan {
         vk::Sampler sampler = {};
         vk::Format format = {};
 
-        vk::Buffer stagingBuffer = {};
-        VmaAllocation stagingMemory = {};
         vk::ShaderStageFlags stage = vk::ShaderStageFlagBits::eFragment;
     };
 
@@ -54,6 +55,7 @@ class Vulkan {
 
         bool offscreenColor;
         bool offscreenDepth;
+        vk::Extent2D extent = {};  // zero follows the swap chain, a fixed extent is kept across resizes
         std::vector<std::shared_ptr<Texture>> offscreenColorTextures;
         std::shared_ptr<Texture> offscreenDepthTexture;
 
@@ -83,6 +85,10 @@ class Vulkan {
     Vulkan& setDeviceLayers(const vk::ArrayProxyNoTemporaries<const char* const>& layers);
     Vulkan& setDeviceExtensions(const vk::ArrayProxyNoTemporaries<const char* const>& extensions);
     Vulkan& setDeviceFeatures(const vk::PhysicalDeviceFeatures& features);
+    // loaded at init when it was written by the same device and driver, saved on destruction, empty disables it
+    Vulkan& setPipelineCacheFile(const std::string& fileName);
+    // compiled shaders are kept there by the text of their source and includes, empty disables it
+    Vulkan& setShaderCacheDir(const std::string& dirName);
 
     void init(vk::Extent2D extent, std::function<vk::SurfaceKHR(const vk::Instance&)> getSurfaceKHR,
               uint32_t renderPassCount, std::function<bool(const vk::PhysicalDevice&)> pickDevice = {});
@@ -92,40 +98,94 @@ class Vulkan {
                           uint32_t vertexStride, const std::vector<vk::Format>& vertexFormats,
                           const std::map<int, Buffer>& uniforms, const std::map<int, Texture>& textures,
                           uint32_t subpass, vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack,
-                          bool autoDestroy = true);
+                          bool autoDestroy = true, bool blendEnable = true, uint32_t pushConstantSize = 0);
     uint32_t attachShader(vk::ShaderModule vertexShaderModule, vk::ShaderModule fragmentShaderModule,
                           const std::vector<uint32_t>& vertexStrides, const std::vector<vk::Format>& vertexFormats,
                           const std::map<int, Buffer>& uniforms, const std::map<int, Texture>& textures,
                           vk::PrimitiveTopology primitiveTopology, uint32_t subpass,
-                          vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack, bool autoDestroy = true);
+                          vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack, bool autoDestroy = true,
+                          uint32_t pushConstantSize = 0);
+    // records the block of pushConstantSize bytes declared in attachShader(), for the following draws of i
+    void pushConstants(uint32_t i, const void* data);
     void renderBegin();
+    void bind(uint32_t i, const Buffer& vertex, vk::DeviceSize offset = 0);
     void draw(uint32_t i, const Buffer& vertex);
+    void drawVertices(uint32_t firstVertex, uint32_t vertexCount, uint32_t firstInstance = 0);
     void drawIndexed(uint32_t i, const vk::Buffer& index, vk::DeviceSize indexOffset, vk::IndexType indexType,
                      uint32_t count, const std::vector<vk::Buffer>& vertex,
                      const std::vector<vk::DeviceSize>& vertexOffset);
+    // runs task(0) .. task(count - 1) on the worker threads, each records on secondary command buffers of its own
+    // that are executed in the order of the tasks, after what was recorded before in the subpass, the tasks may only
+    // push, bind and draw
+    void recordParallel(int count, const std::function<void(int)>& task);
+    // the secondary command buffer of the calling thread in the current subpass, begun on first use
+    const vk::CommandBuffer& commandBuffer();
     void nextSubpass();
-    void nextPass();
+    // a skipped pass is not begun, its offscreen attachments keep what was last drawn in them
+    void nextPass(bool skip = false);
     void renderEnd();
     void resize(vk::Extent2D extent);
 
+    // a block of the uniform ring, with a copy per frame in flight picked by a dynamic offset when it is bound,
+    // the copies of the frames it is not rewritten in keep what was last written
     Buffer createUniformBuffer(vk::DeviceSize size);
+    // into the copy of the frame recorded next, once the GPU is done with that frame
+    void writeUniform(const Buffer& buffer, const void* data);
     void destroyUniformBuffer(const Buffer& buffer);
+    // bound at GLOBAL_SET for every draw, before any is attached, with the constants shared by the whole frame
+    void setGlobalUniform(const Buffer& buffer);
+    static constexpr uint32_t GLOBAL_SET = 2;
 
-    Buffer createVertexBuffer(const void* vertices, uint32_t stride, size_t size);
+    // device local geometry is filled from a staging ring, the copies wait for flushUploads() to be submitted
+    // together, host visible geometry is read across the bus by every draw but costs no copy when rewritten
+    enum class Placement { DeviceLocal, HostVisible };
+
+    Buffer createVertexBuffer(const void* vertices, uint32_t stride, size_t size,
+                              Placement placement = Placement::DeviceLocal);
     void destroyVertexBuffer(const Buffer& buffer);
 
-    Buffer createGltfBuffer(const void* data, size_t size);
+    // one copy per frame in flight, so it can be rewritten every frame after renderBegin
+    Buffer createDynamicVertexBuffer(uint32_t stride, size_t size);
+    void destroyDynamicVertexBuffer(const Buffer& buffer);
+    vk::DeviceSize frameOffset(const Buffer& buffer) const { return frame.current * buffer.size; }
+
+    Buffer createGltfBuffer(const void* data, size_t size, Placement placement = Placement::DeviceLocal);
     void destroyGltfBuffer(const Buffer& buffer);
 
+    // submits the staged copies and texture uploads as one batch on the transfer queue without waiting for them,
+    // renderBegin() does it before every frame, the frames submitted after it wait for the batch on the GPU
+    uint64_t flushUploads();
+    // the value returned by flushUploads() is reached by the upload semaphore once its batch is done
+    bool isUploadComplete(uint64_t value);
+    void waitUploads(uint64_t value);
+
     Texture createTexture(vk::Extent2D extent, const void* data, uint32_t layers = 1, bool cubemap = false,
                           bool anisotropy = true, vk::Filter mag = vk::Filter::eLinear,
                           vk::Filter min = vk::Filter::eLinear,
                           vk::SamplerAddressMode modeU = vk::SamplerAddressMode::eRepeat,
                           vk::SamplerAddressMode modeV = vk::SamplerAddressMode::eRepeat,
                           vk::SamplerAddressMode modeW = vk::SamplerAddressMode::eRepeat);
+    // a mip chain baked offline, in any format the device samples such as the block compressed ones, each level
+    // holds all the layers one after another and is copied as it is
+    Texture createTexture(vk::Format format, vk::Extent2D extent, const std::vector<std::vector<char>>& levels,
+                          uint32_t layers = 1, bool cubemap = false, bool anisotropy = true,
+                          vk::Filter mag = vk::Filter::eLinear, vk::Filter min = vk::Filter::eLinear,
+                          vk::SamplerAddressMode modeU = vk::SamplerAddressMode::eRepeat,
+                          vk::SamplerAddressMode modeV = vk::SamplerAddressMode::eRepeat,
+                          vk::SamplerAddressMode modeW = vk::SamplerAddressMode::eRepeat);
+    bool isTextureFormatSupported(vk::Format format) const;
+    // rewrites a box of the texels of a single level texture, packed by layer then by row, and keeps the others,
+    // with the next batch of uploads on the graphics queue, after the frames sampling it without waiting for them
+    void updateTexture(const Texture& texture, vk::Offset2D offset, vk::Extent2D extent, uint32_t baseLayer,
+                       uint32_t layers, const void* data);
     void destroyTexture(const Texture& texture);
 
     vk::ShaderModule createShaderModule(vk::ShaderStageFlagBits shaderStage, const std::string& shaderText);
+    vk::ShaderModule createShaderModule(const std::vector<unsigned int>& shaderSPV);
+    // the module is only written by resolveShaderModules(), which compiles all the requests on a thread pool
+    void requestShaderModule(vk::ShaderStageFlagBits shaderStage, const std::string& shaderText,
+                             vk::ShaderModule& shaderModule, const std::string& name = {});
+    void resolveShaderModules();
     void destroyShaderModule(const vk::ShaderModule& shader);
 
     static RenderPassBuilder makeRenderPassBuilder(const vk::ArrayProxy<vk::Format>& formats,
@@ -139,20 +199,48 @@ class Vulkan {
     void enumerateDevice(std::function<bool(const vk::PhysicalDevice&)> pickDevice);
     void initDevice(std::function<vk::SurfaceKHR(const vk::Instance&)> getSurfaceKHR);
     void initCommandBuffer();
+    void initPipelineCache();
+    void savePipelineCache();
     void initSwapChain(vk::Extent2D extent);
     void initFrameBuffers();
     void initDescriptorSet(const std::map<int, Buffer>& uniforms, const std::map<int, Texture>& textures);
+    vk::DescriptorSet allocateDescriptorSet(const vk::DescriptorSetLayout& setLayout);
     uint32_t initPipeline(const vk::ShaderModule& vertexShaderModule, const vk::ShaderModule& fragmentShaderModule,
                           uint32_t vertexStride, const std::vector<vk::Format>& vertexFormats, uint32_t subpass,
-                          vk::CullModeFlags cullMode);
+                          vk::CullModeFlags cullMode, bool blendEnable = true, uint32_t pushConstantSize = 0);
     uint32_t initPipeline(const vk::ShaderModule& vertexShaderModule, const vk::ShaderModule& fragmentShaderModule,
                           const std::vector<uint32_t>& vertexStrides, const std::vector<vk::Format>& vertexFormats,
-                          vk::PrimitiveTopology primitiveTopology, uint32_t subpass, vk::CullModeFlags cullMode);
+                          vk::PrimitiveTopology primitiveTopology, uint32_t subpass, vk::CullModeFlags cullMode,
+                          uint32_t pushConstantSize = 0);
     uint32_t initPipeline(const vk::ShaderModule& vertexShaderModule, const vk::ShaderModule& fragmentShaderModule,
                           const vk::PipelineVertexInputStateCreateInfo& vertexInfo,
                           vk::PrimitiveTopology primitiveTopology, uint32_t subpass, vk::CullModeFlags cullMode,
-                          const vk::PushConstantRange& pushConstant = {});
-    void destroySwapChain();
+                          const vk::PushConstantRange& pushConstant = {}, bool blendEnable = true);
+    // from the shader cache, or compiled and added to it, safe to call from any thread
+    std::vector<unsigned int> loadSPV(vk::ShaderStageFlagBits shaderStage, const std::string& shaderText,
+                                      bool& cached) const;
+    Buffer createGeometryBuffer(const void* data, size_t size, vk::BufferUsageFlags usage, Placement placement);
+    // copies the data to the ring, or to a buffer of the staging pool when it is larger, for the next batch
+    std::pair<vk::Buffer, vk::DeviceSize> stageData(const void* data, vk::DeviceSize size);
+    void stageBuffer(const Buffer& buffer, const void* data);
+    // drops the uploads of a resource not flushed yet, or waits for the batch still writing it
+    void unstageBuffer(const Buffer& buffer);
+    void unstageImage(const vk::Image& image);
+    // frees the batches the GPU is done with
+    void collectUploads();
+    void releaseStaging(const Buffer& staging);
+    // with a sampler and a view of all its mips, its content is staged by the caller
+    Texture createTextureImage(vk::Format format, vk::Extent2D extent, uint32_t mipLevels, uint32_t layers,
+                               bool cubemap, bool anisotropy, vk::Filter mag, vk::Filter min,
+                               vk::SamplerAddressMode modeU, vk::SamplerAddressMode modeV,
+                               vk::SamplerAddressMode modeW);
+    void uploadTexture(const Texture& texture, vk::Extent2D extent, const void* data, uint32_t layers,
+                       uint32_t mipLevels);
+    // waits once per frame for its copies of the uniforms, and carries there the blocks written in the others
+    void beginUniformFrame();
+    char* uniformData(uint32_t block, int slot);
+    const std::vector<uint32_t>& uniformOffsets(uint32_t i);
+    void destroySwapChain(bool keepFixedPasses = false);
 
    private:
     vk::ApplicationInfo applicationInfo = {};
@@ -165,14 +253,16 @@ class Vulkan {
     vk::PhysicalDevice physicalDevice;
     uint32_t graphicsQueueFamliyIndex;
     uint32_t presentationQueueFamliyIndex;
+    uint32_t transferQueueFamilyIndex;  // a transfer only family when there is one, else the graphics one
     std::vector<const char*> deviceExtensions;
     vk::Device device;
     vk::Queue graphicsQueue;
     vk::Queue presentationQueue;
     vk::Queue computeQueue;
+    vk::Queue transferQueue;
     VmaAllocator vmaAllocator;
     vk::CommandPool commandPool;
-    vk::CommandBuffer commandBuffer;
+    vk::CommandPool transferCommandPool;
     vk::Extent2D imageExtent;
     vk::SwapchainKHR swapChain;
     std::vector<vk::Image> swapChainImages;
@@ -180,6 +270,98 @@ class Vulkan {
     vk::ClearColorValue bgColor;
     uint32_t minImageCount;
 
+    std::string pipelineCacheFile = "pipeline_cache.bin";
+    vk::PipelineCache pipelineCache;
+    bool pipelineCacheLoaded = false;
+    uint32_t pipelineCount = 0;
+    float pipelineTime = 0;  // in milliseconds, spent creating pipelines
+
+    std::string shaderCacheDir = "shader_cache";
+    uint32_t shaderCount = 0;
+    uint32_t shaderCacheHits = 0;
+    float shaderTime = 0;  // in milliseconds, spent loading or compiling shaders
+
+    uint32_t textureCount = 0;
+    uint32_t bakedTextureCount = 0;       // created from prebuilt levels
+    vk::DeviceSize textureBytes = 0;      // of all the levels created
+    vk::DeviceSize textureRgbaBytes = 0;  // the same levels would take as RGBA8
+    float textureTime = 0;                // in milliseconds, spent creating and staging textures
+
+    struct StagedCopy {
+        vk::Buffer source;
+        vk::Buffer destination;
+        vk::BufferCopy region;
+    };
+    struct StagedImage {
+        vk::Buffer source;
+        vk::Image image;
+        vk::Format format;
+        vk::Extent2D extent;
+        uint32_t layers;
+        uint32_t mipLevels;
+        std::vector<vk::BufferImageCopy> regions;  // of the first levels, the others are blitted from them
+        bool patch = false;                         // of a texture already sampled, its other texels are kept
+    };
+    struct UploadBatch {
+        uint64_t value;  // of the upload semaphore once it is done
+        vk::CommandBuffer transferCommands;
+        vk::CommandBuffer graphicsCommands;  // acquires what the transfer queue released, and blits the mips
+        vk::DeviceSize stagingBegin, stagingEnd;  // of the ring it copies from
+        std::vector<Buffer> staging;              // from the staging pool, back to it once done
+        std::vector<vk::Buffer> buffers;
+        std::vector<vk::Image> images;
+    };
+    Buffer stagingRing;
+    vk::DeviceSize stagingHead = 0;
+    vk::DeviceSize stagingBegin = 0;  // of the uploads not flushed yet, the ring never wraps inside a batch
+    std::vector<StagedCopy> stagedCopies;
+    std::vector<StagedImage> stagedImages;
+    std::vector<Buffer> stagingOverflow;  // for the copies larger than the ring, until they are flushed
+    std::vector<Buffer> stagingPool;      // mapped, of the batches done with them
+    vk::DeviceSize stagingPoolSize = 0;
+    std::deque<UploadBatch> uploadBatches;
+    vk::Semaphore uploadSemaphore;  // a timeline, counting the submissions of the batches
+    uint64_t uploadValue = 0;
+
+    // the uniform blocks are carved from chunks holding a slot per frame in flight, at the same offset in each slot
+    struct UniformChunk {
+        Buffer buffer;
+        vk::DeviceSize slotSize;
+        vk::DeviceSize head = 0;
+    };
+    struct UniformBlock {
+        uint32_t chunk;
+        vk::DeviceSize offset;   // in its slots
+        vk::DeviceSize size;     // aligned, a freed block is reused by another of the same size
+        std::vector<char> data;  // as last written
+        int stale = 0;           // of the slots not written since
+    };
+    std::vector<UniformChunk> uniformChunks;
+    std::vector<UniformBlock> uniformBlocks;
+    std::vector<uint32_t> freeUniformBlocks;
+    vk::DeviceSize uniformAlignment = 0;
+    uint32_t maxDynamicUniforms = 0;
+    uint64_t uniformFrame = -1;  // the count of the frame its slot was last prepared for
+
+    vk::DescriptorSetLayout globalSetLayout;
+    vk::DescriptorSet globalSet;
+    vk::DeviceSize globalSlotSize = 0;
+    vk::DescriptorSetLayout emptySetLayout;  // for the sets a draw does not have before the global one
+
+    struct ShaderRequest {
+        vk::ShaderStageFlagBits stage;
+        std::string text;
+        vk::ShaderModule* module;
+        std::string name;
+    };
+    std::vector<ShaderRequest> shaderRequests;
+
+    // draws created with the same state share their pipeline and its layout, keyed by the bytes of that state
+    std::unordered_map<std::string, vk::PipelineLayout> pipelineLayouts;
+    std::unordered_map<std::string, vk::Pipeline> pipelines;
+    // of the SPIR-V of the live modules, a destroyed module handle can be reused for another shader
+    std::unordered_map<VkShaderModule, uint64_t> shaderHashes;
+
     struct RenderResource {
         std::vector<vk::Framebuffer> framebuffers;
         vk::RenderPass renderPass;
@@ -188,27 +370,38 @@ class Vulkan {
 
     uint32_t currentBuffer;
     uint32_t renderIndex = -1;
+    bool passBegun = false;
     std::vector<RenderResource> renderResources;
 
     std::vector<vk::Framebuffer>& framebuffers() { return renderResources[renderIndex].framebuffers; }
     vk::RenderPass& renderPass() { return renderResources[renderIndex].renderPass; }
     RenderPassBuilder& renderPassBuilder() { return renderResources[renderIndex].renderPassBuilder; }
+    vk::Extent2D renderExtent() { return renderPassBuilder().extent.width ? renderPassBuilder().extent : imageExtent; }
 
     struct DrawResource {
-        vk::DescriptorSetLayout descriptorSetLayout = {};
-        vk::DescriptorPool descriptorPool = {};
+        vk::DescriptorSetLayout descriptorSetLayout = {};  // shared
         vk::DescriptorSet descriptorSet = {};
-        vk::PipelineLayout pipelineLayout = {};
-        vk::Pipeline graphicsPipeline = {};
+        std::string bindingsKey;  // of its descriptor set layout
+        vk::PipelineLayout pipelineLayout = {};  // shared
+        vk::Pipeline graphicsPipeline = {};      // shared
+        std::vector<vk::DeviceSize> uniformSlots;  // the slot size of the chunk of each dynamic uniform, by binding
+        uint32_t pushConstantSize = 0;             // of its own block, else drawIndexed() pushes the draw id
     };
     std::vector<DrawResource> drawResources;
 
+    // the draws with the same bindings share a set layout, and write their sets with its update template
+    struct DescriptorLayout {
+        vk::DescriptorSetLayout setLayout = {};
+        vk::DescriptorUpdateTemplate updateTemplate = {};
+    };
+    std::unordered_map<std::string, DescriptorLayout> descriptorLayouts;
+    // the sets of all the draws come from these, a full pool is followed by one twice as large
+    std::vector<vk::DescriptorPool> descriptorPools;
+    uint32_t descriptorPoolSets = 0;  // of the last pool
+
     vk::DescriptorSetLayout& descriptorSetLayout(size_t i = -1) {
         return drawResources[i == -1 ? drawResources.size() - 1 : i].descriptorSetLayout;
     }
-    vk::DescriptorPool& descriptorPool(size_t i = -1) {
-        return drawResources[i == -1 ? drawResources.size() - 1 : i].descriptorPool;
-    }
     vk::DescriptorSet& descriptorSet(size_t i = -1) {
         return drawResources[i == -1 ? drawResources.size() - 1 : i].descriptorSet;
     }
@@ -227,6 +420,7 @@ class Vulkan {
         std::array<vk::Semaphore, FRAME_IN_FLIGHT> imageRenderedSemaphores;
         std::array<vk::Fence, FRAME_IN_FLIGHT> drawFences;
         int current = 0;
+        uint64_t count = 0;  // of the frames submitted
 
         void init(const vk::Device& device, const vk::CommandPool& commandPool) {
             for (int i = 0; i < FRAME_IN_FLIGHT; ++i) {
@@ -253,7 +447,30 @@ class Vulkan {
         const vk::Fence& drawFence() const { return drawFences[current]; }
         const vk::CommandBuffer& commandBuffer() const { return commandBuffers[current]; }
 
-        void next() { current = (current + 1) % FRAME_IN_FLIGHT; }
+        void next() {
+            current = (current + 1) % FRAME_IN_FLIGHT;
+            ++count;
+        }
     };
     FrameInFlight frame;
+
+    // every subpass is recorded on secondary command buffers, a recorder per thread with a command pool per frame in
+    // flight, reset as a whole when the frame begins again
+    struct Recorder {
+        std::array<vk::CommandPool, FrameInFlight::FRAME_IN_FLIGHT> commandPools;
+        std::array<std::vector<vk::CommandBuffer>, FrameInFlight::FRAME_IN_FLIGHT> commandBuffers;
+        size_t used = 0;  // of the current frame
+        vk::CommandBuffer current;
+        std::vector<uint32_t> dynamicOffsets;  // of the draw being bound
+    };
+    std::vector<Recorder> recorders;                 // the main thread first, then the workers of recordParallel()
+    static thread_local Recorder* threadRecorder;    // of a worker inside recordParallel()
+    std::vector<vk::CommandBuffer> subpassCommands;  // ended in the current subpass, in their order
+    uint32_t subpassIndex = 0;
+
+    Recorder& recorder() { return threadRecorder ? *threadRecorder : recorders.front(); }
+    void initRecorders();
+    vk::CommandBuffer endRecording(Recorder& recorder);
+    // executes what the subpass recorded on the primary command buffer of the frame
+    void executeSubpass();
 };